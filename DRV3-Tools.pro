@@ -3,8 +3,12 @@ TEMPLATE = subdirs
 SUBDIRS += \
     utils \
     unit_tests \
+    benchmarks \
+    fuzz \
     spc_ex \
     stx_ex \
+    wrd_ex \
+    dat_ex \
     spc_editor \
     stx_editor \
     wrd_editor \
@@ -12,8 +16,12 @@ SUBDIRS += \
 
 
 unit_tests.depends = utils
+benchmarks.depends = utils
+fuzz.depends = utils
 spc_ex.depends = utils
 stx_ex.depends = utils
+wrd_ex.depends = utils
+dat_ex.depends = utils
 spc_editor.depends = utils
 stx_editor.depends = utils
 wrd_editor.depends = utils
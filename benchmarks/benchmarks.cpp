@@ -0,0 +1,255 @@
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QTextStream>
+#include <QVector>
+#include <QtTest>
+#include "../utils/binarydata.h"
+#include "../utils/spc.h"
+
+// Throughput (in MB/s of uncompressed data) and compression ratio of spc_cmp, spc_dec and srd_dec,
+// over every file in unit_tests/test_data. Each result is checked for an exact round trip.
+// Results are written to "benchmark_results.csv" in the working directory, and their compressed
+// sizes are compared with "baseline.csv" next to this file. Copy a results file over the baseline
+// to update it. Throughput depends too much on the machine to check against a stored figure,
+// so it's only reported.
+class Benchmarks : public QObject
+{
+    Q_OBJECT
+
+public:
+    Benchmarks();
+
+private Q_SLOTS:
+    void initTestCase();
+    void codecs_data();
+    void codecs();
+    void cleanupTestCase();
+
+private:
+    struct Result
+    {
+        QString codec;
+        QString file;
+        int size;
+        int out_size;
+        double mb_per_sec;
+    };
+
+    QHash<QString, Result> baseline;    // Keyed by "codec,file"
+    QVector<Result> results;
+};
+
+// There's no SRD compressor in utils, so build a "$CMP" file out of "$CLN" chunks with a simple greedy LZ.
+// It only uses runs of up to 63 raw bytes, and copies of 3-63 bytes from up to 127 bytes back.
+static QByteArray srd_cmp_chunk(const QByteArray &data)
+{
+    QByteArray result;
+    int pos = 0;
+    int raw_start = 0;
+
+    auto flush_raw = [&](const int end)
+    {
+        while (raw_start < end)
+        {
+            const int count = qMin(end - raw_start, 63);
+            result.append((char)(count << 1));
+            result.append(data.mid(raw_start, count));
+            raw_start += count;
+        }
+    };
+
+    while (pos < data.size())
+    {
+        int best_len = 0;
+        int best_offset = 0;
+        for (int offset = 1; offset <= qMin(pos, 127); ++offset)
+        {
+            int len = 0;
+            while (len < 63 && pos + len < data.size() && data.at(pos + len) == data.at(pos + len - offset))
+                ++len;
+
+            if (len > best_len)
+            {
+                best_len = len;
+                best_offset = offset;
+            }
+        }
+
+        if (best_len >= 3)
+        {
+            flush_raw(pos);
+            result.append((char)((best_len << 1) | 1));
+            result.append((char)best_offset);
+            pos += best_len;
+            raw_start = pos;
+        }
+        else
+        {
+            ++pos;
+        }
+    }
+    flush_raw(pos);
+
+    return result;
+}
+
+static QByteArray srd_cmp_for_test(const QByteArray &data)
+{
+    const int chunk_size = 0x4000;
+
+    QByteArray chunks;
+    for (int pos = 0; pos < data.size(); pos += chunk_size)
+    {
+        const QByteArray chunk = srd_cmp_chunk(data.mid(pos, chunk_size));
+        chunks.append("$CLN");
+        chunks.append(num_to_bytes<uint>(qMin(chunk_size, data.size() - pos), true));
+        chunks.append(num_to_bytes<uint>(chunk.size() + 0x10, true));
+        chunks.append(4, 0x00);
+        chunks.append(chunk);
+    }
+
+    // Laid out the way srd_dec() reads the header
+    QByteArray result;
+    result.append("$CMP");
+    result.append(8, 0x00);
+    result.append(num_to_bytes<uint>(data.size(), true));
+    result.append(num_to_bytes<uint>(chunks.size(), true));
+    result.append(4, 0x00);
+    result.append(4, 0x00);
+    result.append(chunks);
+    result.append("$CT0");
+    result.append(0x0C, 0x00);
+    return result;
+}
+
+static QByteArray run_codec(const QString &codec, const QByteArray &input, const int dec_size)
+{
+    if (codec == "spc_cmp")
+        return spc_cmp(input);
+    else if (codec == "spc_dec")
+        return spc_dec(input, dec_size);
+    else
+        return srd_dec(input);
+}
+
+Benchmarks::Benchmarks()
+{
+}
+
+void Benchmarks::initTestCase()
+{
+    QFile f(QString(SRCDIR) + "baseline.csv");
+    if (!f.open(QFile::ReadOnly | QFile::Text))
+        return;
+
+    QTextStream stream(&f);
+    stream.readLine();  // Header
+    while (!stream.atEnd())
+    {
+        const QStringList fields = stream.readLine().split(',');
+        if (fields.count() < 4)
+            continue;
+
+        const Result result = {fields[0], fields[1], fields[2].toInt(), fields[3].toInt(), 0};
+        baseline.insert(result.codec + "," + result.file, result);
+    }
+}
+
+void Benchmarks::codecs_data()
+{
+    QTest::addColumn<QString>("codec");
+    QTest::addColumn<QString>("filepath");
+
+    const QString data_dir = QString(SRCDIR) + "../unit_tests/test_data";
+    QDirIterator it(data_dir, QStringList(), QDir::Files);
+    QStringList files;
+    while (it.hasNext())
+        files.append(it.next());
+    files.sort();
+
+    for (const QString codec : {"spc_cmp", "spc_dec", "srd_dec"})
+    {
+        for (const QString &filepath : files)
+            QTest::newRow(qPrintable(codec + " " + QFileInfo(filepath).fileName())) << codec << filepath;
+    }
+}
+
+void Benchmarks::codecs()
+{
+    QFETCH(QString, codec);
+    QFETCH(QString, filepath);
+
+    QFile f(filepath);
+    QVERIFY(f.open(QFile::ReadOnly));
+    const QByteArray orig_data = f.readAll();
+    f.close();
+
+    QByteArray input;
+    if (codec == "spc_cmp")
+        input = orig_data;
+    else if (codec == "spc_dec")
+        input = spc_cmp(orig_data);
+    else
+        input = srd_cmp_for_test(orig_data);
+
+    // QBENCHMARK also runs the body to warm up and calibrate, so time each call on its own
+    // and keep the fastest, rather than timing the whole loop.
+    QByteArray output;
+    qint64 nsecs = -1;
+    QElapsedTimer timer;
+    try
+    {
+        QBENCHMARK
+        {
+            timer.start();
+            output = run_codec(codec, input, orig_data.size());
+            const qint64 elapsed = timer.nsecsElapsed();
+            if (nsecs < 0 || elapsed < nsecs)
+                nsecs = elapsed;
+        }
+    }
+    catch (...)
+    {
+        QFAIL("Codec threw an exception.");
+    }
+
+    // Every round trip must be byte-exact
+    if (codec == "spc_cmp")
+        QCOMPARE(spc_dec(output, orig_data.size()), orig_data);
+    else
+        QCOMPARE(output, orig_data);
+
+    const double secs = (double)nsecs / 1e9;
+    const double mb_per_sec = (secs > 0) ? orig_data.size() / (1024.0 * 1024.0) / secs : 0;
+    const int cmp_size = (codec == "spc_cmp") ? output.size() : input.size();
+    const Result result = {codec, QFileInfo(filepath).fileName(), orig_data.size(), cmp_size, mb_per_sec};
+    results.append(result);
+
+    qInfo("%s %s: %.2f MB/s, ratio %.3f", qPrintable(codec), qPrintable(result.file), mb_per_sec,
+          orig_data.isEmpty() ? 1.0 : (double)cmp_size / orig_data.size());
+
+    const QString key = codec + "," + result.file;
+    if (!baseline.contains(key))
+        return;
+
+    const Result &base = baseline[key];
+    if (cmp_size > base.out_size)
+        QWARN(qPrintable(QString("Compressed size regressed: %1 bytes, baseline was %2.").arg(cmp_size).arg(base.out_size)));
+}
+
+void Benchmarks::cleanupTestCase()
+{
+    QFile f(QDir::currentPath() + QDir::separator() + "benchmark_results.csv");
+    if (!f.open(QFile::WriteOnly | QFile::Text))
+        return;
+
+    QTextStream stream(&f);
+    stream << "codec,file,size,out_size,mb_per_sec\n";
+    for (const Result &result : results)
+        stream << result.codec << "," << result.file << "," << result.size << "," << result.out_size << "," << QString::number(result.mb_per_sec, 'f', 2) << "\n";
+}
+
+QTEST_APPLESS_MAIN(Benchmarks)
+
+#include "benchmarks.moc"
@@ -26,11 +26,13 @@ DEFINES += QT_DEPRECATED_WARNINGS
 SOURCES += \
         main.cpp \
         mainwindow.cpp \
-    dat_ui_model.cpp
+    dat_ui_model.cpp \
+    dat_ui_delegate.cpp
 
 HEADERS += \
         mainwindow.h \
-    dat_ui_model.h
+    dat_ui_model.h \
+    dat_ui_delegate.h
 
 FORMS += \
         mainwindow.ui
@@ -41,3 +43,5 @@ else:unix: LIBS += -L$$OUT_PWD/../utils/ -lutils
 
 INCLUDEPATH += $$PWD/../utils
 DEPENDPATH += $$PWD/../utils
+
+include(../widgets/widgets.pri)
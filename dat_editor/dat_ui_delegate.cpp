@@ -0,0 +1,144 @@
+#include "dat_ui_delegate.h"
+#include <climits>
+#include <QComboBox>
+#include <QDoubleValidator>
+#include <QLineEdit>
+#include <QRegularExpressionValidator>
+#include <QSpinBox>
+
+DatUiDelegate::DatUiDelegate(QObject *parent, DatFile *file) : QStyledItemDelegate(parent)
+{
+    dat_file = file;
+}
+
+QWidget *DatUiDelegate::createEditor(QWidget *parent, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    const int col = index.column();
+    if (col < 0 || col >= (*dat_file).columns.count())
+        return QStyledItemDelegate::createEditor(parent, option, index);
+
+    switch ((*dat_file).columns.at(col).type)
+    {
+    case DAT_TYPE_U8:
+    case DAT_TYPE_U16:
+    case DAT_TYPE_S8:
+    case DAT_TYPE_S16:
+    case DAT_TYPE_S32:
+    {
+        QSpinBox *spinBox = new QSpinBox(parent);
+        spinBox->setFrame(false);
+        switch ((*dat_file).columns.at(col).type)
+        {
+        case DAT_TYPE_U8:
+            spinBox->setRange(0, 0xFF);
+            break;
+        case DAT_TYPE_U16:
+            spinBox->setRange(0, 0xFFFF);
+            break;
+        case DAT_TYPE_S8:
+            spinBox->setRange(-0x80, 0x7F);
+            break;
+        case DAT_TYPE_S16:
+            spinBox->setRange(-0x8000, 0x7FFF);
+            break;
+        default:
+            spinBox->setRange(INT_MIN, INT_MAX);
+            break;
+        }
+        return spinBox;
+    }
+    case DAT_TYPE_U32:
+    case DAT_TYPE_U64:
+    case DAT_TYPE_S64:
+    {
+        // Too big for QSpinBox, so the final range check is left to dat_value_from_string()
+        const bool is_signed = (*dat_file).columns.at(col).type == DAT_TYPE_S64;
+        QLineEdit *lineEdit = new QLineEdit(parent);
+        lineEdit->setFrame(false);
+        lineEdit->setValidator(new QRegularExpressionValidator(QRegularExpression(is_signed ? "-?\\d+" : "\\d+"), lineEdit));
+        return lineEdit;
+    }
+    case DAT_TYPE_F32:
+    case DAT_TYPE_F64:
+    {
+        QLineEdit *lineEdit = new QLineEdit(parent);
+        lineEdit->setFrame(false);
+        QDoubleValidator *validator = new QDoubleValidator(lineEdit);
+        validator->setLocale(QLocale::c());
+        lineEdit->setValidator(validator);
+        return lineEdit;
+    }
+    case DAT_TYPE_LABEL:
+    case DAT_TYPE_ASCII:
+    case DAT_TYPE_REFER:
+    case DAT_TYPE_UTF16:
+    {
+        const QStringList &strings = ((*dat_file).columns.at(col).type == DAT_TYPE_UTF16) ? (*dat_file).refs : (*dat_file).labels;
+        QComboBox *comboBox = new QComboBox(parent);
+        comboBox->setFrame(false);
+        for (int i = 0; i < strings.count(); ++i)
+            comboBox->addItem(num_to_hex(i, 4) + ": " + strings.at(i));
+        return comboBox;
+    }
+    case DAT_TYPE_UNKNOWN:
+        break;
+    }
+
+    return QStyledItemDelegate::createEditor(parent, option, index);
+}
+
+void DatUiDelegate::setEditorData(QWidget *editor, const QModelIndex &index) const
+{
+    const QVariant value = index.data(Qt::UserRole);
+    if (!value.isValid())
+    {
+        QStyledItemDelegate::setEditorData(editor, index);
+        return;
+    }
+
+    if (QSpinBox *spinBox = qobject_cast<QSpinBox *>(editor))
+    {
+        spinBox->setValue(value.toInt());
+    }
+    else if (QComboBox *comboBox = qobject_cast<QComboBox *>(editor))
+    {
+        comboBox->setCurrentIndex((int)value.toUInt() < comboBox->count() ? (int)value.toUInt() : -1);
+    }
+    else if (QLineEdit *lineEdit = qobject_cast<QLineEdit *>(editor))
+    {
+        // Show floats with enough digits to survive being written back unchanged
+        if (value.type() == QVariant::Double)
+            lineEdit->setText(QString::number(value.toDouble(), 'g', 17));
+        else if ((QMetaType::Type)value.type() == QMetaType::Float)
+            lineEdit->setText(QString::number(value.toFloat(), 'g', 9));
+        else
+            lineEdit->setText(value.toString());
+    }
+    else
+    {
+        QStyledItemDelegate::setEditorData(editor, index);
+    }
+}
+
+void DatUiDelegate::setModelData(QWidget *editor, QAbstractItemModel *model, const QModelIndex &index) const
+{
+    // Everything goes through the model as text, so it's validated the same way as any other edit
+    if (QSpinBox *spinBox = qobject_cast<QSpinBox *>(editor))
+    {
+        spinBox->interpretText();
+        model->setData(index, QString::number(spinBox->value()), Qt::EditRole);
+    }
+    else if (QComboBox *comboBox = qobject_cast<QComboBox *>(editor))
+    {
+        if (comboBox->currentIndex() >= 0)
+            model->setData(index, QString::number(comboBox->currentIndex(), 16), Qt::EditRole);
+    }
+    else if (QLineEdit *lineEdit = qobject_cast<QLineEdit *>(editor))
+    {
+        model->setData(index, lineEdit->text(), Qt::EditRole);
+    }
+    else
+    {
+        QStyledItemDelegate::setModelData(editor, model, index);
+    }
+}
@@ -0,0 +1,22 @@
+#ifndef DAT_UI_DELEGATE_H
+#define DAT_UI_DELEGATE_H
+
+#include <QStyledItemDelegate>
+#include "../utils/dat.h"
+
+// Gives each data column an editor suited to its type: spin boxes for small integers,
+// validated line edits for 64-bit integers and floats, and a drop-down list for string indexes.
+class DatUiDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+public:
+    DatUiDelegate(QObject *parent, DatFile *file);
+    QWidget *createEditor(QWidget *parent, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+    void setEditorData(QWidget *editor, const QModelIndex &index) const override;
+    void setModelData(QWidget *editor, QAbstractItemModel *model, const QModelIndex &index) const override;
+
+private:
+    DatFile *dat_file;
+};
+
+#endif // DAT_UI_DELEGATE_H
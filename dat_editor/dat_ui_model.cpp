@@ -6,6 +6,30 @@ DatUiModel::DatUiModel(QObject * /*parent*/, DatFile *file, const int mode)
 {
     dat_file = file;
     data_mode = mode;
+    if (data_mode == 0)
+        row_cache.resize(dat_row_count(*dat_file));
+}
+
+void DatUiModel::clearCache()
+{
+    for (QVector<QVariant> &values : row_cache)
+        values.clear();
+
+    if (rowCount() > 0 && columnCount() > 0)
+        emit dataChanged(index(0, 0), index(rowCount() - 1, columnCount() - 1));
+}
+
+const QVector<QVariant> &DatUiModel::cachedRow(const int row) const
+{
+    QVector<QVariant> &values = row_cache[row];
+    if (values.isEmpty())
+    {
+        const int col_count = (*dat_file).columns.count();
+        values.reserve(col_count);
+        for (int col = 0; col < col_count; ++col)
+            values.append(dat_value_to_variant(*dat_file, row, col));
+    }
+    return values;
 }
 
 int DatUiModel::rowCount(const QModelIndex & /*parent*/) const
@@ -14,7 +38,7 @@ int DatUiModel::rowCount(const QModelIndex & /*parent*/) const
     {
     case 0:
     {
-        return (*dat_file).data.count();
+        return dat_row_count(*dat_file);
     }
     case 1:
     {
@@ -49,7 +73,7 @@ int DatUiModel::columnCount(const QModelIndex & /*parent*/) const
 
 QVariant DatUiModel::data(const QModelIndex &index, int role) const
 {
-    if (role != Qt::DisplayRole && role != Qt::EditRole)
+    if (role != Qt::DisplayRole && role != Qt::EditRole && role != Qt::UserRole)
         return QVariant();
 
     const int row = index.row();
@@ -59,48 +83,30 @@ QVariant DatUiModel::data(const QModelIndex &index, int role) const
     {
     case 0:
     {
-        const QVector<QByteArray> data = (*dat_file).data.at(row);
-        const QString data_type = (*dat_file).data_types.at(col);
+        // UserRole gives the typed value, for DatUiDelegate's editors
+        const QVariant value = cachedRow(row).value(col);
+        if (role == Qt::UserRole)
+            return value;
 
-        int pos = 0;
-        if (data_type == "LABEL" || data_type == "ASCII" || data_type == "REFER")
-        {
-            const ushort label_index = num_from_bytes<ushort>(data.at(col), pos);
-            if (label_index < (*dat_file).labels.count() && role == Qt::DisplayRole)
-                return (*dat_file).labels.at(label_index);
-            else
-                return QString::number(label_index, 16);
-        }
-        else if (data_type == "UTF16")
+        switch ((*dat_file).columns.at(col).type)
         {
-            const ushort string_index = num_from_bytes<ushort>(data.at(col), pos);
-            if (string_index < (*dat_file).refs.count() && role == Qt::DisplayRole)
-                return (*dat_file).refs.at(string_index);
-            else
-                return QString::number(string_index, 16);
-        }
-        else if (data_type.startsWith("u"))
+        case DAT_TYPE_LABEL:
+        case DAT_TYPE_ASCII:
+        case DAT_TYPE_REFER:
+        case DAT_TYPE_UTF16:
         {
-            if (data_type.right(2) == "16")
-                return QString::number(num_from_bytes<ushort>(data.at(col), pos));
-            else if (data_type.right(2) == "32")
-                return QString::number(num_from_bytes<uint>(data.at(col), pos));
+            const QStringList &strings = ((*dat_file).columns.at(col).type == DAT_TYPE_UTF16) ? (*dat_file).refs : (*dat_file).labels;
+            const uint string_index = value.toUInt();
+            if (role == Qt::DisplayRole && string_index < (uint)strings.count())
+                return strings.at(string_index);
+            return QString::number(string_index, 16);
         }
-        else if (data_type.startsWith("s"))
-        {
-            if (data_type.right(2) == "16")
-                return QString::number(num_from_bytes<short>(data.at(col), pos));
-            else if (data_type.right(2) == "32")
-                return QString::number(num_from_bytes<int>(data.at(col), pos));
-        }
-        else if (data_type.startsWith("f"))
-        {
-            if (data_type.right(2) == "32")
-                return QString::number(num_from_bytes<float>(data.at(col), pos));
-            else if (data_type.right(2) == "64")
-                return QString::number(num_from_bytes<double>(data.at(col), pos));
+        case DAT_TYPE_F32:
+        case DAT_TYPE_F64:
+            return QString::number(value.toDouble());
+        default:
+            return value.toString();
         }
-        break;
     }
     case 1:
     {
@@ -143,48 +149,12 @@ bool DatUiModel::setData(const QModelIndex &index, const QVariant &value, int ro
     {
     case 0:
     {
-        const QString type = (*dat_file).data_types.at(col);
-
-        bool ok;
-        QByteArray val;
-        if (type == "LABEL" || type == "ASCII" || type == "REFER" || type == "UTF16")
-        {
-            val = num_to_bytes(value.toString().toUShort(&ok));
-        }
-        else if (type.startsWith("u"))
-        {
-            if (type.right(2) == "16")
-                val = num_to_bytes(value.toString().toUShort(&ok));
-            else if (type.right(2) == "32")
-                val = num_to_bytes(value.toString().toUInt(&ok));
-            else if (type.right(2) == "64")
-                val = num_to_bytes(value.toString().toULongLong(&ok));
-        }
-        else if (type.startsWith("s"))
-        {
-            if (type.right(2) == "16")
-                val = num_to_bytes(value.toString().toShort(&ok));
-            else if (type.right(2) == "32")
-                val = num_to_bytes(value.toString().toInt(&ok));
-            else if (type.right(2) == "64")
-                val = num_to_bytes(value.toString().toLongLong(&ok));
-        }
-        else if (type.startsWith("f"))
-        {
-            if (type.right(2) == "32")
-                val = num_to_bytes(value.toString().toFloat(&ok));
-            else if (type.right(2) == "64")
-                val = num_to_bytes(value.toString().toDouble(&ok));
-        }
-
-        if (!ok)
+        if (!dat_value_from_string(*dat_file, row, col, value.toString()))
         {
             QMessageBox errorMsg(QMessageBox::Warning, "Conversion Error", "Invalid number.", QMessageBox::Ok);
             errorMsg.exec();
             return false;
         }
-
-        (*dat_file).data[row][col] = val;
         break;
     }
     case 1:
@@ -205,6 +175,12 @@ bool DatUiModel::setData(const QModelIndex &index, const QVariant &value, int ro
     }
     }
 
+    if (data_mode == 0)
+    {
+        row_cache[row].clear();
+        emit dataChanged(index, index);
+    }
+
     emit(editCompleted(value.toString()));
     return true;
 }
@@ -221,20 +197,8 @@ bool DatUiModel::insertRows(int row, int count, const QModelIndex & /*parent*/)
         {
         case 0:
         {
-            QVector<QByteArray> blank;
-            for (const QString data_type : (*dat_file).data_types)
-            {
-                if (data_type == "LABEL" || data_type == "ASCII" || data_type == "REFER" || data_type == "UTF16")
-                {
-                    blank.append(QByteArray(2, 0x00));
-                }
-                else if (data_type.startsWith("u") || data_type.startsWith("s") || data_type.startsWith("f"))
-                {
-                    const int data_size = data_type.right(2).toInt() / 8;
-                    blank.append(QByteArray(data_size, 0x00));
-                }
-            }
-            (*dat_file).data.insert(row + r, blank);
+            dat_insert_rows(*dat_file, row + r, 1);
+            row_cache.insert(row + r, QVector<QVariant>());
             break;
         }
         case 1:
@@ -270,7 +234,8 @@ bool DatUiModel::removeRows(int row, int count, const QModelIndex & /*parent*/)
         {
         case 0:
         {
-            (*dat_file).data.removeAt(row);
+            dat_remove_rows(*dat_file, row, 1);
+            row_cache.removeAt(row);
             break;
         }
         case 1:
@@ -311,7 +276,8 @@ bool DatUiModel::moveRows(const QModelIndex & /*sourceParent*/, int sourceRow, i
         {
         case 0:
         {
-            (*dat_file).data.move(sourceRow + r, destinationRow + r);
+            dat_move_row(*dat_file, sourceRow + r, destinationRow + r);
+            row_cache.move(sourceRow + r, destinationRow + r);
             break;
         }
         case 1:
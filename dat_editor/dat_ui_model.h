@@ -20,9 +20,17 @@ public:
     bool moveRows(const QModelIndex &sourceParent, int sourceRow, int count, const QModelIndex &destinationParent, int destinationRow) override;
     Qt::ItemFlags flags(const QModelIndex &index) const override;
 
+public slots:
+    // Drops every decoded row, e.g. when the strings they point to have changed.
+    void clearCache();
+
 private:
+    const QVector<QVariant> &cachedRow(const int row) const;
+
     DatFile *dat_file;
     int data_mode;  // 0 = data, 1 = strings (ascii), 2 = strings (utf16)
+    // Typed values for each data row, decoded from the struct bytes the first time the row is shown.
+    mutable QVector<QVector<QVariant>> row_cache;
 
 signals:
         void editCompleted(const QString &str);
@@ -8,13 +8,21 @@
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QTableView>
-#include <QTextCodec>
+#include "dat_ui_delegate.h"
 #include "dat_ui_model.h"
+#include "../utils/datcsv.h"
+#include "../utils/vfs.h"
 
 MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MainWindow)
 {
     ui->setupUi(this);
     //ui->tableData->setColumnWidth(1, 170);
+    ui->tableData->setItemDelegate(new DatUiDelegate(this, &currentDat));
+
+    searchDock = new SearchDock("Search labels and references", this);
+    searchDock->setMatchLabel([this](const TextMatch &match) { return ui->tabWidget->tabText(match.source).remove('&') + " " + num_to_hex(match.index, 4); });
+    addDockWidget(Qt::RightDockWidgetArea, searchDock);
+    connect(searchDock, &SearchDock::matchActivated, this, &MainWindow::showSearchResult);
 
     QStringList args = QApplication::arguments();
     if (args.count() <= 1)
@@ -22,7 +30,7 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MainWi
 
     for (int i = 1; i < args.count(); ++i)
     {
-        if (QFileInfo(args[i]).exists() && args[i].endsWith(".dat", Qt::CaseInsensitive))
+        if (vfs_exists(args[i]) && args[i].endsWith(".dat", Qt::CaseInsensitive))
         {
             openFile(args[i]);
             break;
@@ -94,17 +102,15 @@ bool MainWindow::openFile(QString newFilepath)
     }
     if (newFilepath.isEmpty()) return false;
 
-    QFile f(newFilepath);
-    if (!f.open(QFile::ReadOnly)) return false;
+    // The path may also point inside an SPC archive, like "chap1.spc/items.dat"
+    QByteArray in_data;
+    if (!vfs_read(newFilepath, in_data)) return false;
 
-    currentDat = dat_from_bytes(f.readAll());
+    currentDat = dat_from_bytes(in_data);
     currentDat.filename = newFilepath;
-    f.close();
 
     this->setWindowTitle("DAT Editor: " + QFileInfo(newFilepath).fileName());
-    ui->tableData->setModel(new DatUiModel(this, &currentDat, 0));
-    ui->tableStringsAscii->setModel(new DatUiModel(this, &currentDat, 1));
-    ui->tableStringsUtf16->setModel(new DatUiModel(this, &currentDat, 2));
+    reloadAllLists();
 
     ui->centralWidget->setEnabled(true);
     ui->tableData->scrollToTop();
@@ -122,12 +128,15 @@ bool MainWindow::saveFile(QString newFilepath)
     }
     if (newFilepath.isEmpty()) return false;
 
-    QFile f(newFilepath);
-    if (!f.open(QFile::WriteOnly)) return false;
-
-    const QByteArray out_data = dat_to_bytes(currentDat);
-    f.write(out_data);
-    f.close();
+    QByteArray out_data;
+    QString error;
+    if (!dat_to_bytes(currentDat, out_data, error))
+    {
+        QMessageBox errorMsg(QMessageBox::Warning, "Save Error", error, QMessageBox::Ok);
+        errorMsg.exec();
+        return false;
+    }
+    if (!vfs_write(newFilepath, out_data)) return false;
 
     currentDat.filename = newFilepath;
     this->setWindowTitle("DAT Editor: " + QFileInfo(newFilepath).fileName());
@@ -138,6 +147,47 @@ bool MainWindow::saveFile(QString newFilepath)
 
 
 
+void MainWindow::reloadAllLists()
+{
+    DatUiModel *data = new DatUiModel(this, &currentDat, 0);
+    DatUiModel *labels = new DatUiModel(this, &currentDat, 1);
+    DatUiModel *refs = new DatUiModel(this, &currentDat, 2);
+
+    // The data table shows the strings its indexes point to, so re-decode it when those change
+    for (DatUiModel *model : {labels, refs})
+    {
+        QObject::connect(model, &DatUiModel::editCompleted, data, &DatUiModel::clearCache);
+        QObject::connect(model, &DatUiModel::rowsInserted, data, &DatUiModel::clearCache);
+        QObject::connect(model, &DatUiModel::rowsRemoved, data, &DatUiModel::clearCache);
+        QObject::connect(model, &DatUiModel::rowsMoved, data, &DatUiModel::clearCache);
+
+        QObject::connect(model, &DatUiModel::editCompleted, this, &MainWindow::updateSearchIndex);
+        QObject::connect(model, &DatUiModel::rowsInserted, this, &MainWindow::updateSearchIndex);
+        QObject::connect(model, &DatUiModel::rowsRemoved, this, &MainWindow::updateSearchIndex);
+        QObject::connect(model, &DatUiModel::rowsMoved, this, &MainWindow::updateSearchIndex);
+    }
+    updateSearchIndex();
+
+    ui->tableData->setModel(data);
+    ui->tableStringsAscii->setModel(labels);
+    ui->tableStringsUtf16->setModel(refs);
+}
+
+void MainWindow::updateSearchIndex()
+{
+    searchDock->setTexts(1, currentDat.labels);
+    searchDock->setTexts(2, currentDat.refs);
+}
+
+void MainWindow::showSearchResult(int source, int row)
+{
+    ui->tabWidget->setCurrentIndex(source);
+    QTableView *table = ui->tabWidget->currentWidget()->findChild<QTableView *>(QString(), Qt::FindDirectChildrenOnly);
+
+    table->selectRow(row);
+    table->scrollTo(table->model()->index(row, 1));
+}
+
 void MainWindow::on_editCompleted(const QString & /*str*/)
 {
     unsavedChanges = true;
@@ -225,88 +275,26 @@ void MainWindow::on_actionImportCsv_triggered()
     QFile f(csvFilename);
     if (!f.open(QFile::ReadOnly)) return;
 
+    const QByteArray csv = f.readAll();
+    f.close();
+
     DatFile newDat;
-    QTextStream text(&f);
-    text.setCodec(QTextCodec::codecForName("UTF-8"));
-    for (int row = -1; !text.atEnd(); ++row)
+    QString error;
+    if (!dat_from_csv(csv, newDat, error))
     {
-        QStringList items = text.readLine().split(',', QString::SkipEmptyParts);
-        QVector<QByteArray> dataLine;
-
-        for (int col = 0; col < items.count(); ++col)
-        {
-            // First line is the headers (data names & types)
-            if (row == -1)
-            {
-                const QStringList split = items.at(col).split(' ', QString::SkipEmptyParts);
-                newDat.data_names.append(split.at(0));
-                newDat.data_types.append(split.at(1));
-                continue;
-            }
-
-            const QString type = currentDat.data_types.at(col);
-
-            bool ok;
-            QByteArray val;
-            if (type == "LABEL" || type == "ASCII" || type == "REFER" || type == "UTF16")
-            {
-                val = num_to_bytes(items.at(col).toUShort(&ok));
-            }
-            else if (type.startsWith("u"))
-            {
-                if (type.right(2) == "16")
-                    val = num_to_bytes(items.at(col).toUShort(&ok));
-                else if (type.right(2) == "32")
-                    val = num_to_bytes(items.at(col).toUInt(&ok));
-                else if (type.right(2) == "64")
-                    val = num_to_bytes(items.at(col).toULongLong(&ok));
-            }
-            else if (type.startsWith("s"))
-            {
-                if (type.right(2) == "16")
-                    val = num_to_bytes(items.at(col).toShort(&ok));
-                else if (type.right(2) == "32")
-                    val = num_to_bytes(items.at(col).toInt(&ok));
-                else if (type.right(2) == "64")
-                    val = num_to_bytes(items.at(col).toLongLong(&ok));
-            }
-            else if (type.startsWith("f"))
-            {
-                if (type.right(2) == "32")
-                    val = num_to_bytes(items.at(col).toFloat(&ok));
-                else if (type.right(2) == "64")
-                    val = num_to_bytes(items.at(col).toDouble(&ok));
-            }
-
-            if (!ok)
-            {
-                QMessageBox errorMsg(QMessageBox::Warning,
-                                     "Conversion Error",
-                                     "Expected a number at line " + QString::number(row + 1) + ", item " + QString::number(col) + ", but got \"" + items.at(col) + "\". Import has been aborted.",
-                                     QMessageBox::Ok);
-                f.close();
-                errorMsg.exec();
-                return;
-            }
-
-            dataLine.append(val);
-        }
-
-        if (row == -1)
-            continue;
-
-        newDat.data.append(dataLine);
+        QMessageBox errorMsg(QMessageBox::Warning,
+                             "Conversion Error",
+                             error + " Import has been aborted.",
+                             QMessageBox::Ok);
+        errorMsg.exec();
+        return;
     }
 
-    f.close();
-
     currentDat = newDat;
 
     this->setWindowTitle("DAT Editor: {unnamed file}");
     ui->centralWidget->setEnabled(false);
-    ui->tableData->setModel(new DatUiModel(this, &currentDat, 0));
-    ui->tableStringsAscii->setModel(new DatUiModel(this, &currentDat, 1));
-    ui->tableStringsUtf16->setModel(new DatUiModel(this, &currentDat, 2));
+    reloadAllLists();
     ui->centralWidget->setEnabled(true);
 
     ui->tableData->scrollToTop();
@@ -325,70 +313,7 @@ void MainWindow::on_actionExportCsv_triggered()
     QFile f(csvFilename);
     if (!f.open(QFile::WriteOnly)) return;
 
-    QTextStream text(&f);
-    text.setCodec(QTextCodec::codecForName("UTF-8"));
-
-    for (int row = -1; row < currentDat.data.count(); ++row)
-    {
-        for (int col = 0; col < currentDat.data_types.count(); ++col)
-        {
-            // Write data names & types first
-            if (row == -1)
-            {
-                text << currentDat.data_names.at(col) + " " + currentDat.data_types.at(col);
-                text << ",";
-                continue;
-            }
-
-
-            const QByteArray data = currentDat.data.at(row).at(col);
-            const QString data_type = currentDat.data_types.at(col);
-
-            int pos = 0;
-            if (data_type == "LABEL" || data_type == "ASCII" || data_type == "REFER")
-            {
-                const ushort label_index = num_from_bytes<ushort>(data, pos);
-                if (label_index < currentDat.labels.count())
-                    text << currentDat.labels.at(label_index);
-                else
-                    text << QString::number(label_index, 16);
-            }
-            else if (data_type == "UTF16")
-            {
-                const ushort string_index = num_from_bytes<ushort>(data, pos);
-                if (string_index < currentDat.refs.count())
-                    text << currentDat.refs.at(string_index);
-                else
-                    text << QString::number(string_index, 16);
-            }
-            else if (data_type.startsWith("u"))
-            {
-                if (data_type.right(2) == "16")
-                    text << QString::number(num_from_bytes<ushort>(data, pos));
-                else if (data_type.right(2) == "32")
-                    text << QString::number(num_from_bytes<uint>(data, pos));
-            }
-            else if (data_type.startsWith("s"))
-            {
-                if (data_type.right(2) == "16")
-                    text << QString::number(num_from_bytes<short>(data, pos));
-                else if (data_type.right(2) == "32")
-                    text << QString::number(num_from_bytes<int>(data, pos));
-            }
-            else if (data_type.startsWith("f"))
-            {
-                if (data_type.right(2) == "32")
-                    text << QString::number(num_from_bytes<float>(data, pos));
-                else if (data_type.right(2) == "64")
-                    text << QString::number(num_from_bytes<double>(data, pos));
-            }
-
-            text << ",";
-        }
-
-        text << "\n";
-    }
-    text.flush();
+    f.write(dat_to_csv(currentDat));
     f.flush();
     f.close();
 }
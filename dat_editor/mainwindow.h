@@ -7,6 +7,7 @@
 #include <QDropEvent>
 #include <QMimeData>
 #include "../utils/dat.h"
+#include "../widgets/searchdock.h"
 
 namespace Ui {
 class MainWindow;
@@ -35,6 +36,8 @@ private slots:
     void dropEvent(QDropEvent *event);
     void on_actionImportCsv_triggered();
     void on_actionExportCsv_triggered();
+    void updateSearchIndex();
+    void showSearchResult(int source, int row);
 
 private:
     bool confirmUnsaved();
@@ -46,6 +49,7 @@ private:
     Ui::MainWindow *ui;
     DatFile currentDat;
     bool unsavedChanges = false;
+    SearchDock *searchDock;     // Sources are the tab/model indexes: 1 = labels, 2 = refs
 };
 
 #endif // MAINWINDOW_H
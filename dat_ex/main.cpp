@@ -0,0 +1,179 @@
+#include <QDir>
+#include "../utils/batch.h"
+#include "../utils/binarydata.h"
+#include "../utils/dat.h"
+#include "../utils/datcorpus.h"
+#include "../utils/datcsv.h"
+
+void unpack(const QString in_path);
+QString unpack_file(const QString in_filepath, const QString out_filepath);
+void repack(const QString in_path);
+QString repack_file(const QString in_filepath, const QString out_filepath);
+void find(const QString in_path, const QString query);
+
+int main(int argc, char *argv[])
+{
+    QString in_path;
+    bool pack = false;
+    QString query;
+
+    // Parse args
+    for (int i = 1; i < argc; i++)
+    {
+        QString arg = QString(argv[i]);
+
+        if (arg == "-p" || arg == "--pack")
+            pack = true;
+        else if ((arg == "-f" || arg == "--find") && i + 1 < argc)
+            query = QString(argv[++i]);
+        else if (in_path.isEmpty())
+            in_path = QDir(argv[i]).absolutePath();
+    }
+
+    if (in_path.isEmpty())
+    {
+        cout << "Error: No input path specified.\n";
+        cout.flush();
+        return 1;
+    }
+
+    if (!query.isEmpty())
+        find(in_path, query);
+    else if (pack)
+        repack(in_path);
+    else
+        unpack(in_path);
+
+    return 0;
+}
+
+void unpack(const QString in_path)
+{
+    if (QFileInfo(in_path).isDir())
+    {
+        QStringList datNames, outNames;
+        find_files(in_path, "*.dat", in_path + "-ex", ".csv", datNames, outNames);
+        process_files(datNames, outNames, unpack_file, in_path, "Extracting");
+    }
+    else
+    {
+        if (QFileInfo(in_path).suffix().compare("dat", Qt::CaseInsensitive) != 0)
+        {
+            cout << "This is not a .dat file.\n";
+            cout.flush();
+            return;
+        }
+
+        const QString error = unpack_file(in_path, in_path.left(in_path.lastIndexOf('.')) + ".csv");
+        if (!error.isEmpty())
+        {
+            cout << "Error: " << error << "\n";
+            cout.flush();
+        }
+    }
+}
+
+QString unpack_file(const QString in_filepath, const QString out_filepath)
+{
+    QFile in(in_filepath);
+    if (!in.open(QFile::ReadOnly))
+        return "Failed to open file.";
+    const QByteArray bytes = in.readAll();
+    in.close();
+
+    DatFile dat;
+    QString error;
+    if (!dat_from_bytes(bytes, dat, error))
+        return error;
+
+    QDir().mkpath(QFileInfo(out_filepath).absolutePath());
+    QFile out(out_filepath);
+    if (!out.open(QFile::WriteOnly))
+        return "Failed to create \"" + out_filepath + "\".";
+    out.write(dat_to_csv(dat));
+    out.close();
+
+    return QString();
+}
+
+void repack(const QString in_path)
+{
+    if (QFileInfo(in_path).isDir())
+    {
+        QStringList csvNames, outNames;
+        find_files(in_path, "*.csv", in_path + "-cmp", ".dat", csvNames, outNames);
+        process_files(csvNames, outNames, repack_file, in_path, "Re-packing");
+    }
+    else
+    {
+        if (QFileInfo(in_path).suffix().compare("csv", Qt::CaseInsensitive) != 0)
+        {
+            cout << "This is not a .csv file.\n";
+            cout.flush();
+            return;
+        }
+
+        const QString error = repack_file(in_path, in_path.left(in_path.lastIndexOf('.')) + ".dat");
+        if (!error.isEmpty())
+        {
+            cout << "Error: " << error << "\n";
+            cout.flush();
+        }
+    }
+}
+
+QString repack_file(const QString in_filepath, const QString out_filepath)
+{
+    QFile in(in_filepath);
+    if (!in.open(QFile::ReadOnly))
+        return "Failed to open file.";
+    const QByteArray csv = in.readAll();
+    in.close();
+
+    DatFile dat;
+    QString error;
+    if (!dat_from_csv(csv, dat, error))
+        return error;
+    QByteArray bytes;
+    if (!dat_to_bytes(dat, bytes, error))
+        return error;
+
+    QDir().mkpath(QFileInfo(out_filepath).absolutePath());
+    QFile out(out_filepath);
+    if (!out.open(QFile::WriteOnly))
+        return "Failed to create \"" + out_filepath + "\".";
+    out.write(bytes);
+    out.close();
+
+    return QString();
+}
+
+// Search every DAT file under "in_path" for rows where "column=value".
+void find(const QString in_path, const QString query)
+{
+    const int split = query.indexOf('=');
+    if (split <= 0)
+    {
+        cout << "Error: Search queries must look like \"column=value\".\n";
+        cout.flush();
+        return;
+    }
+
+    const DatCorpus corpus = dat_corpus_load(in_path);
+    for (const QString &error : corpus.errors)
+        cout << "Error: Failed to load " << error << "\n";
+
+    const QVector<DatMatch> matches = dat_corpus_find(corpus, query.left(split), query.mid(split + 1));
+    for (const DatMatch &match : matches)
+    {
+        const DatFile &dat = corpus.files.at(match.file);
+        QStringList values;
+        for (int col = 0; col < dat.columns.count(); ++col)
+            values.append(dat_value_to_string(dat, match.row, col, true));
+
+        cout << dat.filename << " row " << match.row << ": " << values.join(", ") << "\n";
+    }
+
+    cout << matches.count() << " matching rows in " << corpus.files.count() << " files (" << corpus.schemas.count() << " unique layouts).\n";
+    cout.flush();
+}
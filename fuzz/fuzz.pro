@@ -0,0 +1,46 @@
+#-------------------------------------------------
+#
+# Fuzz/differential harness for the SPC and SRD codecs.
+#
+# Standalone (any compiler):
+#   fuzz [-n iterations] [-seed N] [-max_len bytes] [files or directories to replay...]
+#
+# With libFuzzer (clang only):
+#   qmake CONFIG+=libfuzzer QMAKE_CXX=clang++ QMAKE_LINK=clang++
+#   fuzz corpus_dir/
+#
+#-------------------------------------------------
+
+QT       -= gui
+
+TARGET = fuzz
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+# The following define makes your compiler emit warnings if you use
+# any feature of Qt which has been marked as deprecated (the exact warnings
+# depend on your compiler). Please consult the documentation of the
+# deprecated API in order to know how to port your code away from it.
+DEFINES += QT_DEPRECATED_WARNINGS
+
+libfuzzer {
+    DEFINES += FUZZ_LIBFUZZER
+    QMAKE_CXXFLAGS += -fsanitize=fuzzer,address,undefined
+    QMAKE_LFLAGS += -fsanitize=fuzzer,address,undefined
+}
+
+SOURCES += \
+    main.cpp \
+    reference_codecs.cpp
+
+HEADERS += \
+    reference_codecs.h
+
+win32:CONFIG(release, debug|release): LIBS += -L$$OUT_PWD/../utils/release/ -lutils
+else:win32:CONFIG(debug, debug|release): LIBS += -L$$OUT_PWD/../utils/debug/ -lutils
+else:unix: LIBS += -L$$OUT_PWD/../utils/ -lutils
+
+INCLUDEPATH += $$PWD/../utils
+DEPENDPATH += $$PWD/../utils
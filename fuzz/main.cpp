@@ -0,0 +1,215 @@
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include "../utils/binarydata.h"
+#include "../utils/spc.h"
+#include "reference_codecs.h"
+
+// Compressing is slow, so only round-trip inputs up to this size.
+static const int MAX_CMP_LEN = 0x4000;
+
+static void fail(const char *what, const QByteArray &input)
+{
+    // Keep the input around, so the failure can be replayed
+    QFile f("fuzz-failure.bin");
+    if (f.open(QFile::WriteOnly))
+    {
+        f.write(input);
+        f.close();
+    }
+
+    cout << "Error: " << what << " (input saved to \"fuzz-failure.bin\").\n";
+    cout.flush();
+    abort();
+}
+
+// srd_dec() throws on a size mismatch, so both the output and whether it threw have to match.
+static void check_srd_dec(const QByteArray &bytes, const QByteArray &input)
+{
+    QByteArray result, ref_result;
+    bool threw = false, ref_threw = false;
+
+    try
+    {
+        result = srd_dec(bytes);
+    }
+    catch (...)
+    {
+        threw = true;
+    }
+
+    try
+    {
+        ref_result = ref_srd_dec(bytes);
+    }
+    catch (...)
+    {
+        ref_threw = true;
+    }
+
+    if (threw != ref_threw || result != ref_result)
+        fail("srd_dec output differs from the reference.", input);
+}
+
+// Wraps "input" in a single "$CMP"/"$CLN" chunk, with the sizes the reference decoder expects,
+// so the fuzzed bytes actually reach the chunk decoder through srd_dec().
+static QByteArray srd_wrap(const QByteArray &input)
+{
+    const int dec_size = ref_srd_dec_chunk(input, "$CLN").size();
+
+    QByteArray result;
+    result.append("$CMP");
+    result.append(8, 0x00);
+    result.append(num_to_bytes<uint>(dec_size, true));
+    result.append(num_to_bytes<uint>(input.size() + 0x10, true));
+    result.append(8, 0x00);
+    result.append("$CLN");
+    result.append(num_to_bytes<uint>(dec_size, true));
+    result.append(num_to_bytes<uint>(input.size() + 0x10, true));
+    result.append(4, 0x00);
+    result.append(input);
+    return result;
+}
+
+static void check_input(const QByteArray &input)
+{
+    // The decoders have to match the reference exactly, even on garbage
+    if (spc_dec(input) != ref_spc_dec(input))
+        fail("spc_dec output differs from the reference.", input);
+
+    for (const QString mode : {"$CLN", "$CL1", "$CL2"})
+    {
+        if (srd_dec_chunk(input, mode) != ref_srd_dec_chunk(input, mode))
+            fail("srd_dec_chunk output differs from the reference.", input);
+    }
+
+    check_srd_dec(input, input);
+    check_srd_dec(srd_wrap(input), input);
+
+    // Compressed data doesn't have to match byte-for-byte, but it must decompress
+    // to the original with the reference decoder too, or the game won't read it properly.
+    if (input.size() <= MAX_CMP_LEN)
+    {
+        const QByteArray cmp_data = spc_cmp(input);
+        if (spc_dec(cmp_data, input.size()) != input)
+            fail("spc_cmp output doesn't round-trip through spc_dec.", input);
+        if (ref_spc_dec(cmp_data, input.size()) != input)
+            fail("spc_cmp output doesn't round-trip through the reference decoder.", input);
+    }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    check_input(QByteArray::fromRawData(reinterpret_cast<const char*>(data), (int)size));
+    return 0;
+}
+
+#ifndef FUZZ_LIBFUZZER
+// Without libFuzzer, replay any files given on the command line, then generate inputs:
+// random bytes, compressed data with a few bytes changed, and mutated slices of the given files.
+int main(int argc, char *argv[])
+{
+    int iterations = 10000;
+    uint seed = std::random_device()();
+    int max_len = 4096;
+    QStringList paths;
+
+    // Parse args
+    for (int i = 1; i < argc; i++)
+    {
+        QString arg = QString(argv[i]);
+
+        if (arg == "-n" && i + 1 < argc)
+            iterations = QString(argv[++i]).toInt();
+        else if (arg == "-seed" && i + 1 < argc)
+            seed = QString(argv[++i]).toUInt();
+        else if (arg == "-max_len" && i + 1 < argc)
+            max_len = std::max(QString(argv[++i]).toInt(), 1);
+        else
+            paths.append(QString(argv[i]));
+    }
+
+    QVector<QByteArray> samples;
+    for (const QString &path : paths)
+    {
+        QStringList files;
+        if (QFileInfo(path).isDir())
+        {
+            QDirIterator it(path, QDir::Files, QDirIterator::Subdirectories);
+            while (it.hasNext())
+                files.append(it.next());
+        }
+        else
+        {
+            files.append(path);
+        }
+
+        for (const QString &file : files)
+        {
+            QFile f(file);
+            if (!f.open(QFile::ReadOnly))
+                continue;
+
+            samples.append(f.readAll());
+            f.close();
+            check_input(samples.last().left(max_len));
+        }
+    }
+
+    cout << "Replayed " << samples.count() << " files.\n";
+    cout << "Generating " << iterations << " inputs with seed " << seed << ".\n";
+    cout.flush();
+
+    std::mt19937 rng(seed);
+    for (int i = 0; i < iterations; i++)
+    {
+        QByteArray input;
+        const int len = rng() % (max_len + 1);
+
+        switch (rng() % 3)
+        {
+        case 0:     // Random bytes
+            input.resize(len);
+            for (int b = 0; b < len; b++)
+                input[b] = (char)rng();
+            break;
+
+        case 1:     // Valid compressed data, using a small alphabet so there's plenty to back-reference
+        {
+            QByteArray text(std::min(len, MAX_CMP_LEN), 0x00);
+            for (int b = 0; b < text.size(); b++)
+                text[b] = 'a' + (rng() % 4);
+            input = spc_cmp(text);
+            break;
+        }
+        case 2:     // Part of one of the given files
+            if (!samples.isEmpty())
+            {
+                const QByteArray &sample = samples.at(rng() % samples.count());
+                input = sample.mid(sample.isEmpty() ? 0 : rng() % sample.size(), len);
+            }
+            break;
+        }
+
+        // Change a few bytes
+        const int mutations = input.isEmpty() ? 0 : rng() % 4;
+        for (int m = 0; m < mutations; m++)
+            input[(int)(rng() % input.size())] = (char)rng();
+
+        check_input(input);
+
+        if ((i + 1) % 1000 == 0)
+        {
+            cout << "Checked " << (i + 1) << "/" << iterations << " inputs.\n";
+            cout.flush();
+        }
+    }
+
+    cout << "No differences found.\n";
+    cout.flush();
+    return 0;
+}
+#endif
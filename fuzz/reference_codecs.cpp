@@ -0,0 +1,127 @@
+#include "reference_codecs.h"
+#include "../utils/binarydata.h"
+
+QByteArray ref_spc_dec(const QByteArray &bytes, int dec_size)
+{
+    const int cmp_size = bytes.size();
+
+    if (dec_size <= 0)
+        dec_size = cmp_size * 2;
+
+    QByteArray result;
+    result.reserve(dec_size);
+
+    int flag = 1;
+    int pos = 0;
+
+    while (pos < cmp_size)
+    {
+        if (flag == 1)
+            flag = 0x100 | bit_reverse(bytes.at(pos++));
+
+        if (pos >= cmp_size)
+            break;
+
+        if (flag & 1)
+        {
+            result.append(bytes.at(pos++));
+        }
+        else
+        {
+            // Little-endian, and the high byte may be missing at the very end of the data
+            ushort b = (uchar)bytes.at(pos++);
+            if (pos < cmp_size)
+                b |= (uchar)bytes.at(pos) << 8;
+            pos++;
+
+            const int count = (b >> 10) + 2;
+            const int offset = b & 1023;
+            if (result.size() - 1024 + offset < 0)
+                break;
+
+            for (int i = 0; i < count; ++i)
+                result.append(result.at(result.size() - 1024 + offset));
+        }
+
+        flag >>= 1;
+    }
+
+    return result;
+}
+
+QByteArray ref_srd_dec_chunk(const QByteArray &chunk, const QString &cmp_mode)
+{
+    QByteArray result;
+    int shift;
+
+    if (cmp_mode == "$CLN")
+        shift = 8;
+    else if (cmp_mode == "$CL1")
+        shift = 7;
+    else if (cmp_mode == "$CL2")
+        shift = 6;
+    else
+        return result;
+
+    int pos = 0;
+    while (pos < chunk.size())
+    {
+        const uchar b = chunk.at(pos++);
+
+        if (b & 1)
+        {
+            if (pos >= chunk.size())
+                break;
+
+            const int count = (b & ((1 << shift) - 1)) >> 1;
+            const int offset = ((b >> shift) << 8) | (uchar)chunk.at(pos++);
+            if (offset <= 0 || offset > result.size())
+                break;
+
+            for (int i = 0; i < count; ++i)
+                result.append(result.at(result.size() - offset));
+        }
+        else
+        {
+            for (int i = 0; i < (b >> 1) && pos < chunk.size(); ++i)
+                result.append(chunk.at(pos++));
+        }
+    }
+
+    return result;
+}
+
+QByteArray ref_srd_dec(const QByteArray &bytes)
+{
+    int pos = 0;
+    if (str_from_bytes(bytes, pos, 4) != "$CMP")
+        return bytes;
+
+    // The header fields are read the same (lenient) way srd_dec() reads them
+    pos = 0x0C;
+    const int dec_size = num_from_bytes<uint>(bytes, pos, true);
+    pos = 0x1C;
+
+    QByteArray result;
+    while (true)
+    {
+        const QString cmp_mode = str_from_bytes(bytes, pos, 4);
+        if (!cmp_mode.startsWith("$CL") && cmp_mode != "$CR0")
+            break;
+
+        num_from_bytes<uint>(bytes, pos, true);     // Chunk's decompressed size, which isn't checked
+        const int chunk_cmp_size = num_from_bytes<uint>(bytes, pos, true);
+        pos += 4;
+
+        const QByteArray chunk = get_bytes(bytes, pos, chunk_cmp_size - 0x10);
+        if (cmp_mode == "$CR0")
+            result.append(chunk);
+        else
+            result.append(ref_srd_dec_chunk(chunk, cmp_mode));
+    }
+
+    if (result.size() != dec_size)
+        throw "ref_srd_dec size mismatch error";
+
+    return result;
+}
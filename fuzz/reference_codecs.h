@@ -0,0 +1,15 @@
+#ifndef REFERENCE_CODECS_H
+#define REFERENCE_CODECS_H
+
+#include <QByteArray>
+#include <QString>
+
+// Straightforward, byte-at-a-time copies of the SPC/SRD decoders in utils, kept here on purpose.
+// Any faster rewrite of the versions in utils must produce exactly the same output as these,
+// for every input (valid or not), so don't "optimize" them.
+QByteArray ref_spc_dec(const QByteArray &bytes, int dec_size = -1);
+QByteArray ref_srd_dec_chunk(const QByteArray &chunk, const QString &cmp_mode);
+// Throws if the decompressed size doesn't match the header, the same as srd_dec().
+QByteArray ref_srd_dec(const QByteArray &bytes);
+
+#endif // REFERENCE_CODECS_H
@@ -32,6 +32,8 @@ void MainWindow::on_actionOpen_triggered()
 
 void MainWindow::on_actionSave_triggered()
 {
+    finishPendingCompression();
+
     const QByteArray out_data = spc_to_bytes(currentSpc);
     QString outName = currentSpc.filename;
     QFile f(outName);
@@ -39,6 +41,11 @@ void MainWindow::on_actionSave_triggered()
     f.write(out_data);
     f.close();
     unsavedChanges = false;
+
+    // Subfiles have moved in the saved archive, so point them at their new locations
+    const SpcFile saved = spc_from_bytes(out_data);
+    for (int i = 0; i < currentSpc.subfiles.count(); i++)
+        currentSpc.subfiles[i].offset = saved.subfiles.at(i).offset;
 }
 
 void MainWindow::on_actionSaveAs_triggered()
@@ -58,105 +65,25 @@ void MainWindow::on_actionExit_triggered()
 
 void MainWindow::on_actionExtractAll_triggered()
 {
-    QString outDir = QFileDialog::getExistingDirectory();
-    if (outDir.isEmpty()) return;
-
-    QProgressDialog progressDlg("Extracting file", QString(), 0, currentSpc.subfiles.count() - 1, this);
-    progressDlg.setWindowModality(Qt::WindowModal);
-    progressDlg.setWindowFlags(progressDlg.windowFlags() & ~Qt::WindowCloseButtonHint & ~Qt::WindowContextHelpButtonHint);
-    progressDlg.show();
-
-    bool overwriteAll = false;
-    bool skipAll = false;
+    QVector<int> rows;
     for (int i = 0; i < currentSpc.subfiles.count(); i++)
-    {
-        const SpcSubfile subfile = currentSpc.subfiles.at(i);
-
-        progressDlg.setLabelText("Extracting file " + QString::number(i + 1) + "/" + QString::number(currentSpc.subfiles.count()) + ": " + subfile.filename);
-        progressDlg.setValue(i);
-
-        if (QFile(outDir + QDir::separator() + subfile.filename).exists())
-        {
-            QMessageBox::StandardButton reply;
-            if (!overwriteAll && !skipAll)
-            {
-                reply = QMessageBox::question(&progressDlg, "Confirm overwrite",
-                                              subfile.filename + " already exists in this location. Would you like to overwrite it?",
-                                              QMessageBox::Yes|QMessageBox::YesToAll|QMessageBox::No|QMessageBox::NoToAll|QMessageBox::Cancel);
-
-                if (reply == QMessageBox::Cancel) break;
-
-                overwriteAll = (reply == QMessageBox::YesToAll);
-                skipAll = (reply == QMessageBox::NoToAll);
-            }
-
-            if (skipAll || reply == QMessageBox::No)
-            {
-                continue;
-            }
-        }
+        rows.append(i);
 
-        QApplication::processEvents();
-
-        // We also reach this code if we choose "Yes" or "YesToAll" on the overwrite confirmation dialog
-        extractFile(outDir, subfile);
-    }
-    progressDlg.reset();
+    extractFiles(rows);
 }
 
 void MainWindow::on_actionExtractSelected_triggered()
 {
-    QFileDialog folderDlg;
-    QString outDir = folderDlg.getExistingDirectory();
-    if (outDir.isEmpty())
+    // selectedIndexes() has an entry for every selected cell, not just every row
+    QVector<int> rows;
+    for (const QModelIndex &index : ui->tableView->selectionModel()->selectedIndexes())
     {
-        return;
+        if (!rows.contains(index.row()))
+            rows.append(index.row());
     }
+    std::sort(rows.begin(), rows.end());
 
-    QModelIndexList selectedIndexes = ui->tableView->selectionModel()->selectedIndexes();
-
-    QProgressDialog progressDlg("Extracting file", QString(), 0, selectedIndexes.count() - 1, this);
-    progressDlg.setWindowModality(Qt::WindowModal);
-    progressDlg.setWindowFlags(progressDlg.windowFlags() & ~Qt::WindowCloseButtonHint & ~Qt::WindowContextHelpButtonHint);
-    progressDlg.show();
-
-    bool overwriteAll = false;
-    bool skipAll = false;
-    for (int i = 0; i < selectedIndexes.count(); i++)
-    {
-        int index = ui->tableView->selectionModel()->selectedIndexes().at(i).row();
-        const SpcSubfile subfile = currentSpc.subfiles.at(index);
-
-        progressDlg.setLabelText("Extracting file " + QString::number(i + 1) + "/" + QString::number(selectedIndexes.count()) + ": " + subfile.filename);
-        progressDlg.setValue(i);
-
-        if (QFile(outDir + QDir::separator() + subfile.filename).exists())
-        {
-            QMessageBox::StandardButton reply;
-            if (!overwriteAll && !skipAll)
-            {
-                reply = QMessageBox::question(&progressDlg, "Confirm overwrite",
-                                              subfile.filename + " already exists in this location. Would you like to overwrite it?",
-                                              QMessageBox::Yes|QMessageBox::YesToAll|QMessageBox::No|QMessageBox::NoToAll|QMessageBox::Cancel);
-
-                if (reply == QMessageBox::Cancel) break;
-
-                overwriteAll = (reply == QMessageBox::YesToAll);
-                skipAll = (reply == QMessageBox::NoToAll);
-            }
-
-            if (skipAll || reply == QMessageBox::No)
-            {
-                continue;
-            }
-        }
-
-        QApplication::processEvents();
-
-        // We also reach this code if we choose "Yes" or "YesToAll" on the overwrite confirmation dialog
-        extractFile(outDir, subfile);
-    }
-    progressDlg.reset();
+    extractFiles(rows);
 }
 
 void MainWindow::on_actionInjectFile_triggered()
@@ -174,7 +101,8 @@ void MainWindow::on_actionInjectFile_triggered()
     const QByteArray fileData = file.readAll();
     file.close();
 
-    injectFile(QFileInfo(file).fileName(), fileData);
+    if (injectFile(QFileInfo(file).fileName(), fileData))
+        reloadSubfileList();
 }
 
 bool MainWindow::confirmUnsaved()
@@ -202,7 +130,7 @@ void MainWindow::reloadSubfileList()
 {
     QAbstractItemModel *old = ui->tableView->model();
 
-    SpcUiModel *model = new SpcUiModel(this, &currentSpc);
+    SpcUiModel *model = new SpcUiModel(this, &currentSpc, &pendingCompression);
     ui->tableView->setModel(model);
 
     delete old;
@@ -222,6 +150,8 @@ bool MainWindow::openFile(QString newFilepath)
     QFile f(newFilepath);
     if (!f.open(QFile::ReadOnly)) return false;
 
+    // Anything still compressing belongs to the old file
+    pendingCompression.clear();
     currentSpc = spc_from_bytes(f.readAll());
     currentSpc.filename = newFilepath;
     f.close();
@@ -233,41 +163,113 @@ bool MainWindow::openFile(QString newFilepath)
     return true;
 }
 
-void MainWindow::extractFile(QString outDir, const SpcSubfile &subfile)
+void MainWindow::extractFiles(const QVector<int> &rows)
 {
-    QByteArray outData;
-    switch (subfile.cmp_flag)
-    {
-    case 0x01:  // Uncompressed, don't do anything
-        outData = subfile.data;
-        break;
+    if (rows.isEmpty())
+        return;
+
+    QString outDir = QFileDialog::getExistingDirectory();
+    if (outDir.isEmpty()) return;
 
-    case 0x02:  // Compressed
-        outData = spc_dec(subfile.data);
+    // Ask about any overwrites up front, so the actual extraction can run without interruption.
+    QVector<SpcSubfile> subfiles;
+    bool overwriteAll = false;
+    bool skipAll = false;
+    for (const int row : rows)
+    {
+        const SpcSubfile &subfile = currentSpc.subfiles.at(row);
 
-        if (outData.size() != subfile.dec_size)
+        if (QFile(outDir + QDir::separator() + subfile.filename).exists())
         {
-            qDebug() << "Error: Size mismatch, size was " << outData.size() << " but should be " << subfile.dec_size;
+            QMessageBox::StandardButton reply = QMessageBox::No;
+            if (!overwriteAll && !skipAll)
+            {
+                reply = QMessageBox::question(this, "Confirm overwrite",
+                                              subfile.filename + " already exists in this location. Would you like to overwrite it?",
+                                              QMessageBox::Yes|QMessageBox::YesToAll|QMessageBox::No|QMessageBox::NoToAll|QMessageBox::Cancel);
+
+                if (reply == QMessageBox::Cancel) return;
+
+                overwriteAll = (reply == QMessageBox::YesToAll);
+                skipAll = (reply == QMessageBox::NoToAll);
+            }
+
+            if (skipAll || (!overwriteAll && reply == QMessageBox::No))
+            {
+                continue;
+            }
         }
-        break;
 
-    case 0x03:  // Load from external file
-        QString ext_file_name = currentSpc.filename + "_" + subfile.filename;
-        QFile ext_file(ext_file_name);
-        ext_file.open(QFile::ReadOnly);
-        const QByteArray ext_data = ext_file.readAll();
-        ext_file.close();
-        outData = srd_dec(ext_data);
-        break;
+        subfiles.append(subfile);
     }
 
-    QFile outFile(outDir + QDir::separator() + subfile.filename);
-    outFile.open(QFile::WriteOnly);
-    outFile.write(outData);
-    outFile.close();
+    if (subfiles.isEmpty())
+        return;
+
+    QProgressDialog progressDlg("Extracting " + QString::number(subfiles.count()) + " files...", "Cancel", 0, subfiles.count(), this);
+    progressDlg.setWindowModality(Qt::WindowModal);
+    progressDlg.setWindowFlags(progressDlg.windowFlags() & ~Qt::WindowCloseButtonHint & ~Qt::WindowContextHelpButtonHint);
+
+    // Each subfile is decompressed and written on the thread pool. Cancelling stops
+    // any files which haven't been started yet, and lets the rest finish cleanly.
+    // Each file only writes to its own error slot, so no locking is needed.
+    const QString spcFilename = currentSpc.filename;
+    QVector<int> indexes;
+    for (int i = 0; i < subfiles.count(); i++)
+        indexes.append(i);
+    QVector<QString> errors(subfiles.count());
+    QString *errorData = errors.data();
+
+    QFutureWatcher<void> extractWatcher;
+    QObject::connect(&extractWatcher, &QFutureWatcher<void>::progressRangeChanged, &progressDlg, &QProgressDialog::setRange);
+    QObject::connect(&extractWatcher, &QFutureWatcher<void>::progressValueChanged, &progressDlg, &QProgressDialog::setValue);
+    QObject::connect(&extractWatcher, &QFutureWatcher<void>::finished, &progressDlg, &QProgressDialog::reset);
+    QObject::connect(&progressDlg, &QProgressDialog::canceled, &extractWatcher, &QFutureWatcher<void>::cancel);
+
+    extractWatcher.setFuture(QtConcurrent::map(indexes, [&subfiles, outDir, spcFilename, errorData](const int &i) {
+        const SpcSubfile &subfile = subfiles.at(i);
+
+        // External subfiles go through srd_dec(), which throws on corrupt data
+        QByteArray outData;
+        try
+        {
+            outData = spc_subfile_data_cached(subfile, spcFilename);
+        }
+        catch (...)
+        {
+            errorData[i] = subfile.filename + ": Failed to decompress.";
+            return;
+        }
+
+        QFile outFile(outDir + QDir::separator() + subfile.filename);
+        if (!outFile.open(QFile::WriteOnly))
+        {
+            errorData[i] = subfile.filename + ": Failed to create file.";
+            return;
+        }
+        if (outFile.write(outData) != outData.size())
+            errorData[i] = subfile.filename + ": Failed to write file.";
+        outFile.close();
+    }));
+    progressDlg.exec();
+    extractWatcher.waitForFinished();
+
+    QStringList failed;
+    for (const QString &error : errors)
+    {
+        if (!error.isEmpty())
+            failed.append(error);
+    }
+    if (!failed.isEmpty())
+    {
+        QMessageBox::warning(this, "Extraction failed",
+                             QString::number(failed.count()) + " of " + QString::number(subfiles.count()) + " files couldn't be extracted:\n\n" + failed.join('\n'));
+    }
 }
 
-void MainWindow::injectFile(QString name, const QByteArray &fileData)
+// Doesn't reload the subfile list, so several files can be injected before doing that once.
+// Returns false if the user chose not to overwrite an existing subfile.
+bool MainWindow::injectFile(QString name, const QByteArray &fileData)
 {
     SpcSubfile injectFile;
 
@@ -286,7 +288,7 @@ void MainWindow::injectFile(QString name, const QByteArray &fileData)
                                               QMessageBox::Yes|QMessageBox::No);
 
             if (shouldOverwrite != QMessageBox::Yes)
-                return;
+                return false;
 
             fileToOverwrite = i;
             break;
@@ -294,28 +296,9 @@ void MainWindow::injectFile(QString name, const QByteArray &fileData)
     }
 
 
-    QProgressDialog progressDlg("Compressing file, please wait...", QString(), 0, 0, this);
-    progressDlg.setWindowModality(Qt::WindowModal);
-    progressDlg.setWindowFlags(progressDlg.windowFlags() & ~Qt::WindowCloseButtonHint & ~Qt::WindowContextHelpButtonHint);
-
-    QFutureWatcher<QByteArray> cmp_watcher;
-    QObject::connect(&cmp_watcher, &QFutureWatcher<void>::finished, &progressDlg, &QProgressDialog::reset);
-
-    cmp_watcher.setFuture(QtConcurrent::run(&spc_cmp, injectFile.data));
-    progressDlg.exec();
-    cmp_watcher.waitForFinished();
-
-    // If compressing the data doesn't reduce the size, save uncompressed data instead
-    const QByteArray cmp_data = cmp_watcher.result();
-    if (cmp_data.size() > injectFile.data.size())
-    {
-        injectFile.cmp_flag = 0x01;
-    }
-    else
-    {
-        injectFile.cmp_flag = 0x02;
-        injectFile.data = cmp_data;
-    }
+    // Store it uncompressed for now, and compress it in the background.
+    // It's swapped in by applyCompression() once it's done, or when saving.
+    injectFile.cmp_flag = 0x01;
     injectFile.cmp_size = injectFile.data.size();
     injectFile.name_len = injectFile.filename.length();
 
@@ -324,8 +307,75 @@ void MainWindow::injectFile(QString name, const QByteArray &fileData)
     else
         currentSpc.subfiles.append(injectFile);
 
+    PendingCompression pending;
+    pending.dec_data = injectFile.data;
+    pending.cmp_data = QtConcurrent::run(&spc_cmp, injectFile.data);
+    pendingCompression.insert(name, pending);
+
+    QFutureWatcher<QByteArray> *cmpWatcher = new QFutureWatcher<QByteArray>(this);
+    QObject::connect(cmpWatcher, &QFutureWatcher<QByteArray>::finished, this, [this, name, cmpWatcher]() {
+        applyCompression(name);
+        cmpWatcher->deleteLater();
+    });
+    cmpWatcher->setFuture(pending.cmp_data);
+
     unsavedChanges = true;
-    //reloadSubfileList();
+    return true;
+}
+
+void MainWindow::applyCompression(const QString &name)
+{
+    // If the same name was injected again, wait for the newer data instead
+    if (!pendingCompression.contains(name) || !pendingCompression.value(name).cmp_data.isFinished())
+        return;
+
+    const PendingCompression pending = pendingCompression.take(name);
+    for (SpcSubfile &subfile : currentSpc.subfiles)
+    {
+        // Skip it if the subfile was edited in the meantime
+        if (subfile.filename != name || subfile.cmp_flag != 0x01 || subfile.data != pending.dec_data)
+            continue;
+
+        // If compressing the data doesn't reduce the size, keep the uncompressed data instead
+        const QByteArray cmp_data = pending.cmp_data.result();
+        if (cmp_data.size() <= subfile.data.size())
+        {
+            subfile.cmp_flag = 0x02;
+            subfile.data = cmp_data;
+            subfile.cmp_size = subfile.data.size();
+        }
+        break;
+    }
+
+    SpcUiModel *model = qobject_cast<SpcUiModel *>(ui->tableView->model());
+    if (model != nullptr)
+        model->refreshFlags();
+}
+
+void MainWindow::finishPendingCompression()
+{
+    if (pendingCompression.isEmpty())
+        return;
+
+    QList<QFuture<QByteArray>> futures;
+    for (const PendingCompression &pending : pendingCompression)
+        futures.append(pending.cmp_data);
+
+    QProgressDialog progressDlg("Compressing " + QString::number(futures.count()) + " files, please wait...", QString(), 0, 0, this);
+    progressDlg.setWindowModality(Qt::WindowModal);
+    progressDlg.setWindowFlags(progressDlg.windowFlags() & ~Qt::WindowCloseButtonHint & ~Qt::WindowContextHelpButtonHint);
+
+    QFutureWatcher<void> waitWatcher;
+    QObject::connect(&waitWatcher, &QFutureWatcher<void>::finished, &progressDlg, &QProgressDialog::reset);
+    waitWatcher.setFuture(QtConcurrent::run([futures]() {
+        for (QFuture<QByteArray> future : futures)
+            future.waitForFinished();
+    }));
+    progressDlg.exec();
+    waitWatcher.waitForFinished();
+
+    for (const QString &name : pendingCompression.keys())
+        applyCompression(name);
 }
 
 void MainWindow::closeEvent(QCloseEvent *event)
@@ -349,6 +399,7 @@ void MainWindow::dropEvent(QDropEvent *event)
     if (mimeData->hasUrls())
     {
         QList<QUrl> urlList = mimeData->urls();
+        bool injected = false;
 
         for (int i = 0; i < urlList.count(); i++)
         {
@@ -366,10 +417,15 @@ void MainWindow::dropEvent(QDropEvent *event)
                 const QByteArray fileData = f.readAll();
                 f.close();
 
-                injectFile(name, fileData);
+                if (injectFile(name, fileData))
+                    injected = true;
             }
         }
 
+        // Only rebuild the list once, however many files were dropped
+        if (injected)
+            reloadSubfileList();
+
         event->acceptProposedAction();
     }
 }
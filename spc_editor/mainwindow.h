@@ -44,12 +44,15 @@ private:
     bool confirmUnsaved();
     void reloadSubfileList();
     bool openFile(QString newFilepath = QString());
-    void extractFile(QString outDir, const SpcSubfile &subfile);
-    void injectFile(QString name, const QByteArray &fileData);
+    void extractFiles(const QVector<int> &rows);
+    bool injectFile(QString name, const QByteArray &fileData);
+    void applyCompression(const QString &name);
+    void finishPendingCompression();
 
 
     Ui::MainWindow *ui;
     SpcFile currentSpc;
+    QHash<QString, PendingCompression> pendingCompression;
     bool unsavedChanges = false;
 };
 
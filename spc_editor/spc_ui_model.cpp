@@ -2,9 +2,16 @@
 #include <QFileInfo>
 #include <QMessageBox>
 
-SpcUiModel::SpcUiModel(QObject * /*parent*/, SpcFile *file)
+SpcUiModel::SpcUiModel(QObject * /*parent*/, SpcFile *file, const QHash<QString, PendingCompression> *pending)
 {
     spc_file = file;
+    pending_files = pending;
+}
+
+// Call this when a subfile's background compression has finished
+void SpcUiModel::refreshFlags()
+{
+    emit dataChanged(index(0, 0), index(rowCount() - 1, 0));
 }
 
 int SpcUiModel::rowCount(const QModelIndex & /*parent*/) const
@@ -29,6 +36,9 @@ QVariant SpcUiModel::data(const QModelIndex &index, int role) const
 
     if (col == 0)
     {
+        if (role == Qt::DisplayRole && pending_files != nullptr && pending_files->contains(subfile.filename))
+            return QString::number(subfile.cmp_flag) + " (compressing...)";
+
         return QString::number(subfile.cmp_flag);
     }
     else
@@ -77,7 +87,7 @@ bool SpcUiModel::setData(const QModelIndex &index, const QVariant &value, int ro
 
         if (flag == 1 && (*spc_file).subfiles[row].cmp_flag != 1)
         {
-            (*spc_file).subfiles[row].data = spc_dec((*spc_file).subfiles[row].data, (*spc_file).subfiles[row].dec_size);
+            (*spc_file).subfiles[row].data = spc_subfile_data_cached((*spc_file).subfiles[row], (*spc_file).filename);
             (*spc_file).subfiles[row].dec_size = (*spc_file).subfiles[row].data.size();
         }
         else if (flag == 2 && (*spc_file).subfiles[row].cmp_flag != 2)
@@ -87,6 +97,7 @@ bool SpcUiModel::setData(const QModelIndex &index, const QVariant &value, int ro
         }
 
         (*spc_file).subfiles[row].cmp_flag = flag;
+        (*spc_file).subfiles[row].offset = -1;
     }
     // Filename
     else
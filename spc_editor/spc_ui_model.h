@@ -2,14 +2,24 @@
 #define SPC_UI_MODEL_H
 
 #include <QAbstractTableModel>
+#include <QFuture>
+#include <QHash>
 #include <QtWidgets/QTableView>
 #include "../utils/spc.h"
 
+// A subfile which was injected uncompressed, and is being compressed in the background.
+struct PendingCompression
+{
+    QByteArray dec_data;
+    QFuture<QByteArray> cmp_data;
+};
+
 class SpcUiModel : public QAbstractTableModel
 {
     Q_OBJECT
 public:
-    SpcUiModel(QObject *parent, SpcFile *file);
+    SpcUiModel(QObject *parent, SpcFile *file, const QHash<QString, PendingCompression> *pending = nullptr);
+    void refreshFlags();
     int rowCount(const QModelIndex &parent = QModelIndex()) const override;
     int columnCount(const QModelIndex &parent = QModelIndex()) const override;
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
@@ -22,6 +32,7 @@ public:
 
 private:
     SpcFile *spc_file;
+    const QHash<QString, PendingCompression> *pending_files;
 
 signals:
     void editCompleted(const QString &str);
@@ -3,6 +3,7 @@
 #include <QDirIterator>
 #include "../utils/binarydata.h"
 #include "../utils/spc.h"
+#include "../utils/stats.h"
 
 void unpack(const QString in_path);
 void unpack_file(const QString in_file, const QString in_path, const QString dec_path);
@@ -12,6 +13,9 @@ int main(int argc, char *argv[])
 {
     QString in_path;
     bool pack = false;
+    bool print_stats = false;
+    QString stats_json_path;
+    QString stats_trace_path;
 
     // Parse args
     for (int i = 1; i < argc; i++)
@@ -20,6 +24,12 @@ int main(int argc, char *argv[])
 
         if (arg == "-p" || arg == "--pack")
             pack = true;
+        else if (arg == "--stats")
+            print_stats = true;
+        else if (arg == "--stats-json" && i + 1 < argc)
+            stats_json_path = QString(argv[++i]);
+        else if (arg == "--stats-trace" && i + 1 < argc)
+            stats_trace_path = QString(argv[++i]);
         else
             in_path = QDir::toNativeSeparators(QDir(argv[i]).absolutePath());
     }
@@ -31,11 +41,16 @@ int main(int argc, char *argv[])
         return 1;
     }
 
+    if (print_stats || !stats_json_path.isEmpty() || !stats_trace_path.isEmpty())
+        stats_enable(!stats_trace_path.isEmpty());
+
     if (pack)
         repack(in_path);
     else
         unpack(in_path);
 
+    stats_write(print_stats, stats_json_path, stats_trace_path);
+
     return 0;
 }
 
@@ -95,10 +110,16 @@ void unpack_file(const QString in_file, const QString in_path, const QString dec
 
     QFile f(in_file);
     f.open(QFile::ReadOnly);
-    SpcFile spc = spc_from_bytes(f.readAll());
-    spc.filename = in_file;
+    QByteArray bytes;
+    {
+        StatsScope stats("read", f.size());
+        bytes = f.readAll();
+    }
     f.close();
 
+    SpcFile spc = spc_from_bytes(bytes);
+    spc.filename = in_file;
+
 
     // Create a text file containing index data and other info for the extracted files,
     // so we can re-pack them in the correct order (not sure if it matters though)
@@ -115,6 +136,7 @@ void unpack_file(const QString in_file, const QString in_path, const QString dec
         {
         case 0x01:  // Uncompressed
         {
+            StatsScope stats("write", subfile.data.size());
             QFile out(out_path + QDir::separator() + subfile.filename);
             out.open(QFile::WriteOnly);
             out.write(subfile.data);
@@ -131,6 +153,7 @@ void unpack_file(const QString in_file, const QString in_path, const QString dec
                 cout.flush();
             }
 
+            StatsScope stats("write", dec_data.size());
             QFile out(out_path + QDir::separator() + subfile.filename);
             out.open(QFile::WriteOnly);
             out.write(dec_data);
@@ -149,6 +172,7 @@ void unpack_file(const QString in_file, const QString in_path, const QString dec
             const QByteArray ext_data = srd_dec(ext_file.readAll());
             ext_file.close();
 
+            StatsScope stats("write", ext_data.size());
             QFile out(out_path + QDir::separator() + subfile.filename);
             out.open(QFile::WriteOnly);
             out.write(ext_data);
@@ -234,7 +258,11 @@ void repack(const QString in_dir)
 
             QFile f(spc_dir + QDir::separator() + file_name);
             f.open(QFile::ReadOnly);
-            QByteArray subdata = f.readAll();
+            QByteArray subdata;
+            {
+                StatsScope stats("read", f.size());
+                subdata = f.readAll();
+            }
             f.close();
 
             ushort cmp_flag = info_strings.at(i).split('=').at(1).toUShort();
@@ -277,6 +305,7 @@ void repack(const QString in_dir)
         QString out_path = QDir::toNativeSeparators(cmp_dir + QDir::separator() + out_file);
         QDir().mkpath(out_path.left(out_path.lastIndexOf(QDir::separator())));
 
+        StatsScope stats("write", out_data.size());
         QFile out(out_path);
         out.open(QFile::WriteOnly);
         out.write(out_data);
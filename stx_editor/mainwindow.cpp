@@ -6,8 +6,25 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MainWi
     ui->setupUi(this);
 
     connect(ui->listWidget, &QListWidget::currentTextChanged, this, &MainWindow::on_textBox_textChanged);
+    connect(ui->listWidget, &QListWidget::itemChanged, this, &MainWindow::updateSearchEntry);
+
+    // Results are labelled with the STX string ID, which isn't necessarily the row
+    searchDock = new SearchDock("Search strings", this);
+    searchDock->setMatchLabel([this](const TextMatch &match) { return num_to_hex(stringIds.value(match.index, (uint)match.index), 4); });
+    addDockWidget(Qt::RightDockWidgetArea, searchDock);
+    connect(searchDock, &SearchDock::matchActivated, this, &MainWindow::showSearchResult);
 
     openStx.setNameFilter("STX files (*.stx)");
+
+    QStringList args = QApplication::arguments();
+    for (int i = 1; i < args.count(); ++i)
+    {
+        if (vfs_exists(args[i]) && args[i].endsWith(".stx", Qt::CaseInsensitive))
+        {
+            openFile(args[i]);
+            break;
+        }
+    }
 }
 
 MainWindow::~MainWindow()
@@ -48,12 +65,26 @@ bool MainWindow::openFile(QString newFilepath)
     }
     if (newFilepath.isEmpty()) return false;
 
-    QFile f(newFilepath);
-    if(!f.open(QFile::ReadOnly))
+    // The path may also point inside an SPC archive, like "chap1_text_US.spc/script.stx"
+    QByteArray stxData;
+    if (!vfs_read(newFilepath, stxData))
         return false;
 
-    currentStx = f.readAll();
-    f.close();
+    if (!stxData.startsWith(STX_MAGIC.toUtf8()))
+    {
+        QMessageBox errorMsg(QMessageBox::Warning, "Error", "Invalid STX file.", QMessageBox::Ok);
+        errorMsg.exec();
+        return false;
+    }
+
+    QString error;
+    if (!stx_from_bytes(stxData, currentStx, error))
+    {
+        QMessageBox errorMsg(QMessageBox::Warning, "Error", error, QMessageBox::Ok);
+        errorMsg.exec();
+        return false;
+    }
+    currentStx.filename = newFilepath;
 
     currentFilename = newFilepath;
     ui->listWidget->setEnabled(true);
@@ -64,16 +95,26 @@ bool MainWindow::openFile(QString newFilepath)
 void MainWindow::reloadStrings()
 {
     ui->listWidget->clear();
+    stringIds.clear();
 
-    QStringList strings = get_stx_strings(currentStx);
-    for (QString str : strings)
+    for (const StxTable &table : currentStx.tables)
     {
-        str.replace("\n", "\\n");
-        QListWidgetItem *item = new QListWidgetItem(str);
-        item->setFlags(item->flags() | Qt::ItemIsEditable);
-        ui->listWidget->addItem(item);
+        for (int s = 0; s < table.strings.count(); s++)
+        {
+            QString str = table.strings.at(s);
+            str.replace("\n", "\\n");
+            QListWidgetItem *item = new QListWidgetItem(str);
+            item->setFlags(item->flags() | Qt::ItemIsEditable);
+            ui->listWidget->addItem(item);
+            stringIds.append(table.ids.value(s, (uint)s));
+        }
     }
 
+    QStringList texts;
+    for (int i = 0; i < ui->listWidget->count(); i++)
+        texts.append(ui->listWidget->item(i)->text());
+    searchDock->setTexts(0, texts);
+
     unsavedChanges = false;
 }
 
@@ -84,20 +125,25 @@ void MainWindow::on_actionOpen_triggered()
 
 void MainWindow::on_actionSave_triggered()
 {
-    QStringList strings;
-    for(int i = 0; i < ui->listWidget->count(); i++)
+    // The list shows the strings from every table in order,
+    // so put them back the same way to keep the IDs and tables intact.
+    int i = 0;
+    for (StxTable &table : currentStx.tables)
     {
-        QListWidgetItem *item = ui->listWidget->item(i);
-        QString text = item->text();
-        text.replace("\\n", "\n");
-        strings.append(text);
+        for (int s = 0; s < table.strings.count() && i < ui->listWidget->count(); s++)
+        {
+            QString text = ui->listWidget->item(i++)->text();
+            text.replace("\\n", "\n");
+            table.strings[s] = text;
+        }
     }
 
-    currentStx = repack_stx_strings(strings);
-    QFile f(currentFilename);
-    f.open(QFile::WriteOnly);
-    f.write(currentStx);
-    f.close();
+    if (!vfs_write(currentFilename, stx_to_bytes(currentStx)))
+    {
+        QMessageBox errorMsg(QMessageBox::Warning, "Error", "Failed to save \"" + currentFilename + "\".", QMessageBox::Ok);
+        errorMsg.exec();
+        return;
+    }
     unsavedChanges = false;
 }
 
@@ -130,6 +176,17 @@ void MainWindow::on_textBox_textChanged()
     unsavedChanges = true;
 }
 
+void MainWindow::updateSearchEntry(QListWidgetItem *item)
+{
+    searchDock->setText(0, ui->listWidget->row(item), item->text());
+}
+
+void MainWindow::showSearchResult(int /*source*/, int row)
+{
+    ui->listWidget->setCurrentRow(row);
+    ui->listWidget->scrollToItem(ui->listWidget->item(row));
+}
+
 void MainWindow::dragEnterEvent(QDragEnterEvent *event)
 {
     if (event->mimeData()->hasFormat("text/uri-list"))
@@ -14,6 +14,8 @@
 #include <QTextStream>
 #include "../utils/binarydata.h"
 #include "../utils/stx.h"
+#include "../utils/vfs.h"
+#include "../widgets/searchdock.h"
 
 namespace Ui {
 class MainWindow;
@@ -36,6 +38,8 @@ private slots:
     void on_textBox_textChanged();
     void dragEnterEvent(QDragEnterEvent *event);
     void dropEvent(QDropEvent *event);
+    void updateSearchEntry(QListWidgetItem *item);
+    void showSearchResult(int source, int row);
 
 private:
     bool confirmUnsaved();
@@ -46,10 +50,12 @@ private:
     Ui::MainWindow *ui;
     QFileDialog openStx;
     QString currentFilename;
-    QByteArray currentStx;
+    StxFile currentStx;
     QFrame *textBoxFrame;
     //QList<QPlainTextEdit *> textBoxes;
     bool unsavedChanges = false;
+    SearchDock *searchDock;     // One source (0), holding the list's text
+    QVector<uint> stringIds;    // STX string ID of each row in the list
 };
 
 #endif // MAINWINDOW_H
@@ -1,16 +1,21 @@
 #include <QDir>
-#include <QDirIterator>
+#include "../utils/batch.h"
 #include "../utils/binarydata.h"
+#include "../utils/stats.h"
 #include "../utils/stx.h"
 
 void unpack(const QString in_path);
-void unpack_file(const QString in_filepath, const QString in_dirpath);
+QString unpack_file(const QString in_filepath, const QString out_filepath);
 void repack(const QString in_path);
+QString repack_file(const QString in_filepath, const QString out_filepath);
 
 int main(int argc, char *argv[])
 {
     QString in_path;
     bool pack = false;
+    bool print_stats = false;
+    QString stats_json_path;
+    QString stats_trace_path;
 
     // Parse args
     for (int i = 1; i < argc; i++)
@@ -19,6 +24,12 @@ int main(int argc, char *argv[])
 
         if (arg == "-p" || arg == "--pack")
             pack = true;
+        else if (arg == "--stats")
+            print_stats = true;
+        else if (arg == "--stats-json" && i + 1 < argc)
+            stats_json_path = QString(argv[++i]);
+        else if (arg == "--stats-trace" && i + 1 < argc)
+            stats_trace_path = QString(argv[++i]);
         else if (in_path.isEmpty())
             in_path = QDir(argv[i]).absolutePath();
     }
@@ -30,11 +41,16 @@ int main(int argc, char *argv[])
         return 1;
     }
 
+    if (print_stats || !stats_json_path.isEmpty() || !stats_trace_path.isEmpty())
+        stats_enable(!stats_trace_path.isEmpty());
+
     if (pack)
         repack(in_path);
     else
         unpack(in_path);
 
+    stats_write(print_stats, stats_json_path, stats_trace_path);
+
     return 0;
 }
 
@@ -42,21 +58,9 @@ void unpack(const QString in_path)
 {
     if (QFileInfo(in_path).isDir())
     {
-        QDirIterator it(in_path, QStringList() << "*.stx", QDir::Files, QDirIterator::Subdirectories);
-        QStringList stxNames;
-        while (it.hasNext())
-        {
-            stxNames.append(it.next());
-        }
-
-        stxNames.sort();
-        for (int i = 0; i < stxNames.count(); i++)
-        {
-            cout << "Extracting file " << (i + 1) << "/" << stxNames.size() << ": " << QFileInfo(stxNames.at(i)).fileName() << "\n";
-            cout.flush();
-
-            unpack_file(stxNames.at(i), in_path);
-        }
+        QStringList stxNames, outNames;
+        find_files(in_path, "*.stx", in_path + "-ex", ".txt", stxNames, outNames);
+        process_files(stxNames, outNames, unpack_file, in_path, "Extracting");
     }
     else
     {
@@ -67,35 +71,53 @@ void unpack(const QString in_path)
             return;
         }
 
+        QString outName = in_path;
+        outName.replace(".stx", ".txt");
 
-        unpack_file(in_path, in_path);
+        const QString error = unpack_file(in_path, outName);
+        if (!error.isEmpty())
+        {
+            cout << "Error: " << error << "\n";
+            cout.flush();
+        }
     }
 }
 
-void unpack_file(const QString in_filepath, const QString in_dirpath)
+QString unpack_file(const QString in_filepath, const QString out_filepath)
 {
-    QString ex_dirpath = in_dirpath + "-ex";
-    QString rel_filepath = QDir(in_dirpath).relativeFilePath(in_filepath);
-    QString out_filepath = ex_dirpath + '/' + rel_filepath;
-    out_filepath.replace(".stx", ".txt");
-
-    int dirSeparatorIndex = rel_filepath.lastIndexOf('/');
-    if (dirSeparatorIndex > 0)
-        QDir(ex_dirpath).mkpath(rel_filepath.left(dirSeparatorIndex));
-
     QFile in(in_filepath);
-    in.open(QFile::ReadOnly);
-    const QStringList strings = get_stx_strings(in.readAll());
+    if (!in.open(QFile::ReadOnly))
+        return "Failed to open file.";
+    QByteArray stx_data;
+    {
+        StatsScope stats("read", in.size());
+        stx_data = in.readAll();
+    }
     in.close();
 
-    QFile out(out_filepath);
-    out.open(QFile::WriteOnly);
-    for (int i = 0; i < strings.size(); i++)
+    // Don't write anything for files we can't read properly
+    StxFile stx;
+    QString error;
+    if (!stx_from_bytes_view(stx_data, stx, error))
+        return error;
+    const QStringList &strings = stx.tables.first().strings;
+
+    QByteArray text;
     {
-        out.write(QString("##### " + QString::number(i).rightJustified(4, '0') + "\n").toUtf8());
-        out.write(QString(strings.at(i) + "\n\n").toUtf8());
+        StatsScope stats("text_write");
+        text = stx_strings_to_text(strings).toUtf8();
+        stats.set_bytes_out(text.size());
     }
+
+    StatsScope stats("write", text.size());
+    QDir().mkpath(QFileInfo(out_filepath).absolutePath());
+    QFile out(out_filepath);
+    if (!out.open(QFile::WriteOnly))
+        return "Failed to create \"" + out_filepath + "\".";
+    out.write(text);
     out.close();
+
+    return QString();
 }
 
 void repack(const QString in_path)
@@ -111,61 +133,9 @@ void repack(const QString in_path)
             return;
         }
 
-        QDirIterator it(in_path, QStringList() << "*.txt", QDir::Files, QDirIterator::Subdirectories);
-        QStringList txtFiles;
-        while (it.hasNext())
-            txtFiles.append(it.next());
-
-        txtFiles.sort();
-        for (int f = 0; f < txtFiles.count(); f++)
-        {
-            QString file = QDir(in_path).relativeFilePath(txtFiles.at(f));
-            cout << "Re-packing file " << (f + 1) << "/" << txtFiles.count() << ": \"" << file << "\"\n";
-            cout.flush();
-
-            // The original files (usually) use Unix-style line breaks.
-            // A couple files sometimes have the occasional Windows-style line break,
-            // but since these are almost certainly not intentional, we sanitize them anyway.
-            QFile txt(txtFiles[f]);
-            txt.open(QFile::ReadOnly | QIODevice::Text);
-            QStringList allText = QString(txt.readAll()).replace("\r\n", QString('\n')).replace('\r', '\n').split('\n', QString::SkipEmptyParts);
-            txt.close();
-
-            QStringList strings;
-            QString str;
-            int index = 0;
-            for (QString strPart : allText)
-            {
-                if (strPart.startsWith("#"))
-                {
-                    if (!str.isEmpty())
-                    {
-                        strings.append(str);
-                        str.clear();
-                    }
-
-                    index = strPart.replace("##### ", "").toInt();
-                    continue;
-                }
-
-                if (!str.isEmpty())
-                {
-                    str += "\n";
-                }
-                str += strPart;
-            }
-            strings[index] = str;
-            str.clear();
-            QByteArray stxData = repack_stx_strings(strings);
-
-            QString outPath = cmp_dirpath + '/' + file;
-            outPath.replace(".txt", ".stx");
-            QDir().mkpath(outPath.left(outPath.lastIndexOf('/')));
-            QFile outFile(outPath);
-            outFile.open(QFile::WriteOnly);
-            outFile.write(stxData);
-            outFile.close();
-        }
+        QStringList txtFiles, outNames;
+        find_files(in_path, "*.txt", cmp_dirpath, ".stx", txtFiles, outNames);
+        process_files(txtFiles, outNames, repack_file, in_path, "Re-packing");
     }
     else
     {
@@ -173,47 +143,47 @@ void repack(const QString in_path)
         cout << "Re-packing file" << ": \"" << file << "\"\n";
         cout.flush();
 
-        // The original files (usually) use Unix-style line breaks.
-        // A couple files sometimes have the occasional Windows-style line break,
-        // but since these are almost certainly not intentional, we sanitize them anyway.
-        QFile txt(in_path);
-        txt.open(QFile::ReadOnly | QIODevice::Text);
-        QStringList allText = QString(txt.readAll()).replace("\r\n", QString('\n')).replace('\r', '\n').split('\n', QString::SkipEmptyParts);
-        txt.close();
-
-        QStringList strings;
-        QString str;
-        int index = 0;
-        for (QString strPart : allText)
+        QString outPath = file;
+        outPath.replace(".txt", ".stx");
+
+        const QString error = repack_file(in_path, outPath);
+        if (!error.isEmpty())
         {
-            if (strPart.startsWith("#"))
-            {
-                if (!str.isEmpty())
-                {
-                    strings.append(str);
-                    str.clear();
-                }
-
-                index = strPart.replace("##### ", "").toInt();
-                continue;
-            }
-
-            if (!str.isEmpty())
-            {
-                str += "\n";
-            }
-            str += strPart;
+            cout << "Error: " << error << "\n";
+            cout.flush();
         }
-        strings[index] = str;
-        str.clear();
-        QByteArray stxData = repack_stx_strings(strings);
+    }
+}
 
-        QString outPath = file;
-        outPath.replace(".txt", ".stx");
-        QDir().mkpath(outPath.left(outPath.lastIndexOf('/')));
-        QFile outFile(outPath);
-        outFile.open(QFile::WriteOnly);
-        outFile.write(stxData);
-        outFile.close();
+QString repack_file(const QString in_filepath, const QString out_filepath)
+{
+    QFile txt(in_filepath);
+    if (!txt.open(QFile::ReadOnly))
+        return "Failed to open file.";
+    QByteArray text;
+    {
+        StatsScope stats("read", txt.size());
+        text = txt.readAll();
+    }
+    txt.close();
+
+    QStringList strings;
+    {
+        StatsScope stats("text_parse", text.size());
+        QString error;
+        if (!stx_strings_from_text(QString::fromUtf8(text), strings, error))
+            return error;
     }
+
+    const QByteArray stxData = repack_stx_strings(strings);
+
+    StatsScope stats("write", stxData.size());
+    QDir().mkpath(QFileInfo(out_filepath).absolutePath());
+    QFile outFile(out_filepath);
+    if (!outFile.open(QFile::WriteOnly))
+        return "Failed to create \"" + out_filepath + "\".";
+    outFile.write(stxData);
+    outFile.close();
+
+    return QString();
 }
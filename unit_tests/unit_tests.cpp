@@ -1,11 +1,22 @@
 #include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
 #include <QTextStream>
 #include <QVector>
 #include <QtTest>
 #include "../utils/binarydata.h"
 #include "../utils/dat.h"
+#include "../utils/datcorpus.h"
+#include "../utils/datcsv.h"
 #include "../utils/spc.h"
+#include "../utils/stats.h"
+#include "../utils/stx.h"
+#include "../utils/textindex.h"
+#include "../utils/vfs.h"
 #include "../utils/wrd.h"
+#include "../utils/wrdcorpus.h"
 
 class UnitTests : public QObject
 {
@@ -16,9 +27,18 @@ public:
 
 private Q_SLOTS:
     void spcCompression();
+    void spcVirtualFiles();
+    void spcSubfileCache();
+    void codecMalformedInput();
     void datParser();
+    void datCorpusSearch();
     void findWrdVersionChanges();
     void findBadWrdParams();
+    void wrdRoundTrip();
+    void wrdCorpusParams();
+    void stxRoundTrip();
+    void textIndexSearch();
+    void statsScopes();
 };
 
 UnitTests::UnitTests()
@@ -42,18 +62,142 @@ void UnitTests::spcCompression()
         cmp_data = spc_cmp(orig_data);
         dec_data = spc_dec(cmp_data);
 
-        qDebug() << it.fileName() << ": filesize reduced by " << orig_data.size() - cmp_data.size() << " bytes.";
+        // Sizes and speeds are reported by the benchmarks project, this just checks correctness
+        QCOMPARE(dec_data, orig_data);
+    }
+}
 
-        for (int i = 0; i < (int)std::min(orig_data.size(), dec_data.size()); i++)
-        {
-            if (orig_data.at(i) != dec_data.at(i))
-            {
-                qDebug() << "The byte at " + QString::number(i, 16) + " differs. (orig: " + orig_data.at(i) + ", dec: " + dec_data.at(i) + ")";
-            }
-        }
+void UnitTests::codecMalformedInput()
+{
+    // One raw byte, then a back-reference to before the start of the data
+    QByteArray spc_data;
+    spc_data.append((char)bit_reverse(0x01));
+    spc_data.append('A');
+    spc_data.append(num_to_bytes<ushort>(0x0000));
+    QCOMPARE(spc_dec(spc_data), QByteArray("A"));
 
-        //QCOMPARE(dec_data, orig_data);
-    }
+    // Bytes >= 0x80 used to be sign-extended: 128 raw bytes, then 4 bytes copied from 0x80 back
+    QByteArray raw;
+    for (int i = 0; i < 128; i++)
+        raw.append((char)i);
+    QByteArray chunk;
+    chunk.append((char)0xFE);
+    chunk.append(raw.left(127));
+    chunk.append((char)0x02);
+    chunk.append(raw.mid(127));
+    chunk.append((char)0x09);
+    chunk.append((char)0x80);
+    QCOMPARE(srd_dec_chunk(chunk, "$CLN"), raw + raw.left(4));
+
+    // Out of range copies and truncated data just stop decoding
+    QCOMPARE(srd_dec_chunk(QByteArray("\x02" "A" "\x05\x10", 4), "$CLN"), QByteArray("A"));
+    QCOMPARE(srd_dec_chunk(QByteArray("\x03", 1), "$CLN"), QByteArray());
+    QCOMPARE(srd_dec_chunk(chunk, "$CLX"), QByteArray());
+}
+
+void UnitTests::spcVirtualFiles()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    // outer.spc contains inner.spc, which contains script.stx
+    const QByteArray stx_data = repack_stx_strings(QStringList() << "Hello" << "World");
+
+    SpcFile inner;
+    inner.unk1 = QByteArray(0x24, 0x00);
+    inner.unk2 = 0;
+    SpcSubfile stx_subfile;
+    stx_subfile.filename = "script.stx";
+    stx_subfile.data = stx_data;
+    stx_subfile.cmp_flag = 0x01;
+    stx_subfile.unk_flag = 0x04;
+    stx_subfile.cmp_size = stx_data.size();
+    stx_subfile.dec_size = stx_data.size();
+    stx_subfile.name_len = stx_subfile.filename.size();
+    inner.subfiles.append(stx_subfile);
+
+    SpcFile outer = inner;
+    outer.subfiles.clear();
+    SpcSubfile inner_subfile = stx_subfile;
+    inner_subfile.filename = "inner.spc";
+    inner_subfile.data = spc_to_bytes(inner);
+    inner_subfile.cmp_size = inner_subfile.data.size();
+    inner_subfile.dec_size = inner_subfile.data.size();
+    outer.subfiles.append(inner_subfile);
+
+    const QString outer_path = dir.path() + "/outer.spc";
+    QVERIFY(vfs_write(outer_path, spc_to_bytes(outer)));
+
+    QByteArray data;
+    QVERIFY(vfs_exists(outer_path + "/inner.spc/script.stx"));
+    QVERIFY(!vfs_exists(outer_path + "/inner.spc/missing.stx"));
+    QVERIFY(vfs_read(outer_path + "/INNER.SPC/script.stx", data));
+    QCOMPARE(data, stx_data);
+
+    // Replacing a nested subfile rewrites both archives
+    const QByteArray new_stx_data = repack_stx_strings(QStringList() << "Goodbye");
+    QVERIFY(vfs_write(outer_path + "/inner.spc/script.stx", new_stx_data));
+    QVERIFY(vfs_read(outer_path + "/inner.spc/script.stx", data));
+    QCOMPARE(data, new_stx_data);
+
+    // New subfiles are added to the archive
+    QVERIFY(vfs_write(outer_path + "/extra.stx", stx_data));
+    QVERIFY(vfs_read(outer_path + "/extra.stx", data));
+    QCOMPARE(data, stx_data);
+    QVERIFY(vfs_read(outer_path + "/inner.spc/script.stx", data));
+    QCOMPARE(data, new_stx_data);
+
+    // Subfiles stored in external files are refused, and the archive is left untouched
+    SpcFile external = inner;
+    external.subfiles[0].cmp_flag = 0x03;
+    external.subfiles[0].data.clear();
+    const QString external_path = dir.path() + "/external.spc";
+    const QByteArray external_bytes = spc_to_bytes(external);
+    QVERIFY(vfs_write(external_path, external_bytes));
+    QVERIFY(!vfs_write(external_path + "/script.stx", new_stx_data));
+    QVERIFY(vfs_read(external_path, data));
+    QCOMPARE(data, external_bytes);
+}
+
+void UnitTests::spcSubfileCache()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QByteArray stx_data = repack_stx_strings(QStringList() << "Hello" << "World");
+
+    // Compressed subfiles read from an archive are only decompressed once
+    SpcFile packed;
+    packed.unk1 = QByteArray(0x24, 0x00);
+    packed.unk2 = 0;
+    SpcSubfile stx_subfile;
+    stx_subfile.filename = "script.stx";
+    stx_subfile.data = spc_cmp(stx_data);
+    stx_subfile.cmp_flag = 0x02;
+    stx_subfile.unk_flag = 0x04;
+    stx_subfile.cmp_size = stx_subfile.data.size();
+    stx_subfile.dec_size = stx_data.size();
+    stx_subfile.name_len = stx_subfile.filename.size();
+    packed.subfiles.append(stx_subfile);
+    const QString packed_path = dir.path() + "/packed.spc";
+    QVERIFY(vfs_write(packed_path, spc_to_bytes(packed)));
+    QByteArray data;
+    QVERIFY(vfs_read(packed_path, data));
+    const SpcSubfile packed_subfile = spc_from_bytes(data).subfiles.at(0);
+    QVERIFY(packed_subfile.offset > 0);
+
+    const int hits = spc_cache_hits();
+    const QByteArray first = spc_subfile_data_cached(packed_subfile, packed_path);
+    const QByteArray second = spc_subfile_data_cached(packed_subfile, packed_path);
+    QCOMPARE(first, stx_data);
+    QCOMPARE(spc_cache_hits(), hits + 1);
+    QCOMPARE(second.constData(), first.constData());
+
+    // Subfiles that don't come straight from an archive are never cached
+    SpcSubfile edited = packed_subfile;
+    edited.offset = -1;
+    QCOMPARE(spc_subfile_data_cached(edited, packed_path), stx_data);
+    QCOMPARE(spc_subfile_data_cached(edited, packed_path), stx_data);
+    QCOMPARE(spc_cache_hits(), hits + 1);
 }
 
 void UnitTests::datParser()
@@ -69,6 +213,181 @@ void UnitTests::datParser()
         dat_from_bytes(f.readAll());
         f.close();
     }
+
+    DatFile dat;
+    dat.data_names << "id" << "name" << "scale";
+    dat.data_types << "u16" << "LABEL" << "f32";
+    dat_build_columns(dat);
+    QCOMPARE(dat.struct_size, 8);
+    QCOMPARE(dat.columns.at(2).offset, 4);
+
+    dat_insert_rows(dat, 0, 2);
+    dat_set_value<ushort>(dat, 0, 0, 7);
+    dat_set_value<ushort>(dat, 1, 1, 1);
+    dat_set_value<float>(dat, 1, 2, 1.5f);
+    dat.labels << "zero" << "one";
+    dat.refs << "ref";
+    dat_move_row(dat, 1, 0);
+
+    const DatFile parsed = dat_from_bytes(dat_to_bytes(dat));
+    QCOMPARE(dat_row_count(parsed), 2);
+    QCOMPARE(parsed.data, dat.data);
+    QCOMPARE(dat_value<ushort>(parsed, 1, 0), (ushort)7);
+    QCOMPARE(dat_value<float>(parsed, 0, 2), 1.5f);
+    QCOMPARE(parsed.labels, dat.labels);
+    QCOMPARE(parsed.refs, dat.refs);
+
+    // A struct count whose data size overflows an int (0x20000001 * 8 wraps to 8) is rejected
+    QByteArray huge_bytes = dat_to_bytes(dat);
+    huge_bytes.replace(0, 4, num_to_bytes<int>(0x20000001));
+    DatFile huge;
+    QString huge_error;
+    QVERIFY(!dat_from_bytes(huge_bytes, huge, huge_error));
+
+    QCOMPARE(parsed.columns.at(1).type, DAT_TYPE_LABEL);
+    QCOMPARE(dat_value_to_string(parsed, 0, 1), QString("1"));
+    QCOMPARE(dat_value_to_string(parsed, 0, 1, true), QString("one"));
+    QVERIFY(dat_value_from_string(dat, 0, 2, "-2.25"));
+    QVERIFY(!dat_value_from_string(dat, 0, 0, "70000"));
+    QCOMPARE(dat_value_to_string(dat, 0, 2), QString("-2.25"));
+    QCOMPARE(dat_value_to_variant(parsed, 1, 0), QVariant((uint)7));
+    QCOMPARE(dat_value_to_variant(dat, 0, 2).toFloat(), -2.25f);
+
+    // CSV round trip, including quoting and strings shared between rows
+    dat.labels[1] = "a \"quoted\", label";
+    dat_set_value<ushort>(dat, 0, 1, 1);
+    dat_set_value<ushort>(dat, 1, 1, 1);
+    dat_set_value<float>(dat, 1, 2, 0.1f);
+    DatFile csv_dat;
+    QString error;
+    QVERIFY(dat_from_csv(dat_to_csv(dat), csv_dat, error));
+    QCOMPARE(csv_dat.data_types, dat.data_types);
+    QCOMPARE(csv_dat.labels, dat.labels);
+    QCOMPARE(dat_value<float>(csv_dat, 1, 2), 0.1f);
+    QCOMPARE(dat_value<ushort>(csv_dat, 1, 0), (ushort)7);
+    QVERIFY(!dat_from_csv("id u8\n256\n", csv_dat, error));
+
+    // Unused, duplicate and out-of-range strings all survive a CSV round trip unchanged
+    DatFile strings_dat;
+    strings_dat.data_names << "name" << "text";
+    strings_dat.data_types << "LABEL" << "UTF16";
+    dat_build_columns(strings_dat);
+    dat_insert_rows(strings_dat, 0, 3);
+    strings_dat.labels << "zero" << "dup" << "#hash" << "dup";
+    strings_dat.refs << "ref" << "ref";
+    dat_set_value<ushort>(strings_dat, 0, 0, 3);
+    dat_set_value<ushort>(strings_dat, 1, 0, 1);
+    dat_set_value<ushort>(strings_dat, 2, 0, 2);
+    dat_set_value<ushort>(strings_dat, 0, 1, 1);
+    dat_set_value<ushort>(strings_dat, 2, 1, 0x20);
+    QVERIFY(dat_from_csv(dat_to_csv(strings_dat), csv_dat, error));
+    QCOMPARE(dat_to_bytes(csv_dat), dat_to_bytes(strings_dat));
+
+    // String cells are text even without quotes, and a byte order mark is skipped
+    QVERIFY(dat_from_csv("\xEF\xBB\xBFid u8,name LABEL\n1,face\n2,1\n3,face\n", csv_dat, error));
+    QCOMPARE(csv_dat.data_names.first(), QString("id"));
+    QCOMPARE(csv_dat.labels, QStringList() << "face" << "1");
+    QCOMPARE(dat_value<ushort>(csv_dat, 2, 1), (ushort)0);
+    QVERIFY(dat_from_csv("id u8,name LABEL\n1,add\n#LABELS\n0,zero\n1,add\n", csv_dat, error));
+    QCOMPARE(dat_value<ushort>(csv_dat, 0, 1), (ushort)1);
+    QVERIFY(!dat_from_csv("id u8,name LABEL\n1,add\n#LABELS\n1,add\n", csv_dat, error));
+
+    // The label and ref counts are ushorts, so 0xFFFF strings fit but one more doesn't
+    QByteArray limit_csv = "id u8\n#LABELS\n";
+    for (int i = 0; i < 0xFFFF; i++)
+        limit_csv += QByteArray::number(i) + ",s" + QByteArray::number(i) + "\n";
+    QVERIFY(dat_from_csv(limit_csv, csv_dat, error));
+    QCOMPARE(csv_dat.labels.count(), 0xFFFF);
+    QCOMPARE(dat_from_bytes(dat_to_bytes(csv_dat)).labels.count(), 0xFFFF);
+    QVERIFY(!dat_from_csv(limit_csv + "65535,s65535\n", csv_dat, error));
+
+    QByteArray unique_csv = "name LABEL\n";
+    for (int i = 0; i <= 0xFFFF; i++)
+        unique_csv += "s" + QByteArray::number(i) + "\n";
+    QVERIFY(!dat_from_csv(unique_csv, csv_dat, error));
+
+    DatFile over_dat;
+    over_dat.refs.reserve(0x10000);
+    for (int i = 0; i < 0x10000; i++)
+        over_dat.refs.append(QString());
+    QByteArray over_bytes;
+    QVERIFY(!dat_to_bytes(over_dat, over_bytes, error));
+    QVERIFY_EXCEPTION_THROWN(dat_to_bytes(over_dat), int);
+}
+
+void UnitTests::datCorpusSearch()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    // Two files sharing one layout, one with a different layout, and one that's broken
+    DatFile items;
+    items.data_names << "id" << "name" << "scale";
+    items.data_types << "u16" << "LABEL" << "f32";
+    dat_build_columns(items);
+    dat_insert_rows(items, 0, 2);
+    items.labels << "zero" << "one";
+    dat_set_value<ushort>(items, 0, 0, 7);
+    dat_set_value<ushort>(items, 1, 1, 1);
+    dat_set_value<float>(items, 1, 2, 0.123456789f);
+
+    DatFile more_items = items;
+    dat_set_value<ushort>(more_items, 0, 1, 1);
+    dat_set_value<ushort>(more_items, 1, 1, 0);
+    dat_set_value<float>(more_items, 0, 2, 2.5f);
+    dat_set_value<float>(more_items, 1, 2, 1.0f);
+
+    DatFile other;
+    other.data_names << "id";
+    other.data_types << "u32";
+    dat_build_columns(other);
+    dat_insert_rows(other, 0, 1);
+    dat_set_value<uint>(other, 0, 0, 7);
+
+    const QVector<QPair<QString, QByteArray>> fixtures = {
+        {"a.dat", dat_to_bytes(items)},
+        {"sub/b.dat", dat_to_bytes(more_items)},
+        {"c.dat", dat_to_bytes(other)},
+        {"d.dat", QByteArray(4, 0x00)},
+    };
+    QDir().mkpath(dir.path() + "/sub");
+    for (const auto &fixture : fixtures)
+    {
+        QFile f(dir.path() + "/" + fixture.first);
+        QVERIFY(f.open(QFile::WriteOnly));
+        f.write(fixture.second);
+        f.close();
+    }
+
+    const DatCorpus corpus = dat_corpus_load(dir.path());
+    QCOMPARE(corpus.files.count(), 3);
+    QCOMPARE(corpus.schemas.count(), 2);
+    QCOMPARE(corpus.file_schemas, QVector<int>() << 0 << 1 << 0);
+    QCOMPARE(corpus.errors.count(), 1);
+    QVERIFY(corpus.errors.first().startsWith("d.dat"));
+    QCOMPARE(corpus.files.at(2).filename, QString("sub/b.dat"));
+
+    // Numbers are matched in every layout that has the column
+    QVector<DatMatch> matches = dat_corpus_find(corpus, "id", "7");
+    QCOMPARE(matches.count(), 3);
+    QCOMPARE(matches.at(1).file, 1);
+
+    matches = dat_corpus_find(corpus, "name", "one");
+    QCOMPARE(matches.count(), 2);
+    QCOMPARE(matches.at(0).file, 0);
+    QCOMPARE(matches.at(0).row, 1);
+    QCOMPARE(matches.at(1).file, 2);
+    QCOMPARE(matches.at(1).row, 0);
+
+    // Floats match the text they're displayed as, as well as their exact value
+    const QString shown = dat_value_to_string(corpus.files.at(0), 1, 2);
+    QCOMPARE(shown, QString("0.123457"));
+    matches = dat_corpus_find(corpus, "scale", shown);
+    QCOMPARE(matches.count(), 1);
+    QCOMPARE(matches.first().row, 1);
+    QCOMPARE(dat_corpus_find(corpus, "scale", "2.5").count(), 1);
+    QCOMPARE(dat_corpus_find(corpus, "scale", "0.12345").count(), 0);
+    QCOMPARE(dat_corpus_find(corpus, "missing", "7").count(), 0);
 }
 
 void UnitTests::findWrdVersionChanges()
@@ -141,6 +460,240 @@ void UnitTests::findBadWrdParams()
     }
 }
 
+void UnitTests::wrdRoundTrip()
+{
+    WrdFile wrd;
+    wrd.filename = "test.wrd";
+    wrd.labels << "first" << "unused" << "second";
+    wrd.params << "non" << "CHARA";
+    wrd.strings << "Hello" << QString(200, 'a');
+    wrd.external_strings = false;
+    wrd.code << WrdCmd {0x14, "LAB", {0}, {3}}
+             << WrdCmd {0x00, "FLG", {0, 1}, {0, 0}}
+             << WrdCmd {0x46, "LOC", {1}, {2}}
+             << WrdCmd {0x14, "LAB", {2}, {3}}
+             << WrdCmd {0x4A, "LBN", {5}, {1}}
+             << WrdCmd {0x11, "END", {}, {}};
+
+    const QByteArray bytes = wrd_to_bytes(wrd);
+    const WrdFile parsed = wrd_from_bytes(bytes, wrd.filename);
+
+    QCOMPARE(parsed.labels, wrd.labels);
+    QCOMPARE(parsed.params, wrd.params);
+    QCOMPARE(parsed.strings, wrd.strings);
+    QCOMPARE(parsed.code.count(), wrd.code.count());
+    for (int i = 0; i < wrd.code.count(); i++)
+    {
+        QCOMPARE(parsed.code.at(i).opcode, wrd.code.at(i).opcode);
+        QCOMPARE(parsed.code.at(i).args, wrd.code.at(i).args);
+    }
+
+    // Each label's code should be found using the label offset table,
+    // and a label without a "LAB" command should be written out as empty
+    const QVector<QByteArray> label_code = wrd_label_code(bytes);
+    QCOMPARE(label_code.count(), 3);
+    QCOMPARE(wrd_code_to_cmds(label_code.at(0)).count(), 3);
+    QVERIFY(label_code.at(1).isEmpty());
+    QCOMPARE(wrd_code_to_cmds(label_code.at(2)).count(), 3);
+
+    QCOMPARE(wrd_to_bytes(parsed), bytes);
+}
+
+void UnitTests::wrdCorpusParams()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    // Two scripts sharing most of their label and param names
+    WrdFile first;
+    first.labels << "start";
+    first.params << "non" << "CHARA";
+    first.strings << "Hello";
+    first.external_strings = false;
+    first.code << WrdCmd {0x14, "LAB", {0}, {3}}
+               << WrdCmd {0x00, "FLG", {1, 0}, {0, 0}}
+               << WrdCmd {0x11, "END", {}, {}};
+
+    WrdFile second = first;
+    second.labels << "other";
+    second.params.clear();
+    second.params << "CHARA" << "MAP" << "non";
+    second.code.clear();
+    second.code << WrdCmd {0x14, "LAB", {0}, {3}}
+                << WrdCmd {0x00, "FLG", {0, 1}, {0, 0}}
+                << WrdCmd {0x14, "LAB", {1}, {3}}
+                << WrdCmd {0x00, "FLG", {0, 2}, {0, 0}};
+
+    QDir().mkpath(dir.path() + "/sub");
+    QFile f(dir.path() + "/a.wrd");
+    QVERIFY(f.open(QFile::WriteOnly));
+    f.write(wrd_to_bytes(first));
+    f.close();
+    f.setFileName(dir.path() + "/sub/b.wrd");
+    QVERIFY(f.open(QFile::WriteOnly));
+    f.write(wrd_to_bytes(second));
+    f.close();
+
+    const WrdCorpus corpus = wrd_corpus_load(dir.path());
+    QCOMPARE(corpus.files.count(), 2);
+    QVERIFY(corpus.errors.isEmpty());
+    QCOMPARE(corpus.files.at(1).filename, QString("sub/b.wrd"));
+
+    // Each name is only stored once, so the same name gets the same handle in every file
+    QCOMPARE(corpus.names->count(), 5);
+    QCOMPARE(corpus.files.at(0).params.at(1), corpus.files.at(1).params.at(0));
+    QCOMPARE(corpus.files.at(0).labels.at(0), corpus.files.at(1).labels.at(0));
+    QCOMPARE(corpus.names->at(corpus.files.at(1).params.at(1)), QString("MAP"));
+
+    const QVector<WrdParamUse> uses = wrd_corpus_find_param(corpus, "CHARA");
+    QCOMPARE(uses.count(), 3);
+    QCOMPARE(uses.at(0).file, 0);
+    QCOMPARE(uses.at(0).cmd, 1);
+    QCOMPARE(uses.at(0).arg, 0);
+    QCOMPARE(uses.at(1).file, 1);
+    QCOMPARE(uses.at(2).cmd, 3);
+    QVERIFY(wrd_corpus_find_param(corpus, "missing").isEmpty());
+}
+
+void UnitTests::stxRoundTrip()
+{
+    const QStringList strings = QStringList() << "Hello world" << "world" << "" << "Hello world" << "Goodbye" << "bye";
+
+    const QByteArray stx_data = repack_stx_strings(strings);
+    QCOMPARE(get_stx_strings(stx_data), strings);
+    QCOMPARE(get_stx_string_views(stx_data), strings);
+
+    // "world", "" and "bye" can all point into the tails of other strings
+    const QByteArray merged_data = repack_stx_strings(strings, true);
+    QCOMPARE(get_stx_strings(merged_data), strings);
+    QCOMPARE(merged_data.size(), stx_data.size() - (6 + 1 + 4) * 2);
+
+    // Non-sequential string IDs and the language survive a round trip
+    StxFile stx;
+    stx.lang = "USEN";
+    StxTable table;
+    QCOMPARE(table.unk, (uint)8);
+    table.ids << 3 << 7;
+    table.strings << "first" << "second";
+    stx.tables << table;
+
+    const QByteArray id_data = stx_to_bytes(stx);
+    const StxFile parsed = stx_from_bytes(id_data);
+    QCOMPARE(parsed.lang, stx.lang);
+    QCOMPARE(parsed.tables.count(), 1);
+    QCOMPARE(parsed.tables[0].ids, table.ids);
+    QCOMPARE(get_stx_strings(id_data), table.strings);
+    QCOMPARE(stx_to_bytes(parsed), id_data);
+
+    // Layouts with more than one table haven't been verified, so they're rejected
+    QByteArray multi_data = id_data;
+    multi_data[8] = 2;
+    QVERIFY_EXCEPTION_THROWN(stx_from_bytes(multi_data), int);
+    QVERIFY(get_stx_strings(multi_data).isEmpty());
+    StxFile multi;
+    QString multi_error;
+    QVERIFY(!stx_from_bytes(multi_data, multi, multi_error));
+    QVERIFY(multi_error.contains("tables"));
+    QVERIFY(!stx_from_bytes_view(QByteArray("NOPE"), multi, multi_error));
+    stx.tables << table;
+    QVERIFY_EXCEPTION_THROWN(stx_to_bytes(stx), int);
+
+    // WRD scripts save their external strings with the IDs and language they were loaded with
+    WrdFile wrd;
+    wrd.external_stx = parsed;
+    wrd.external_stx.tables[0].strings.clear();
+    wrd.strings << "edited" << "second";
+    const StxFile saved = stx_from_bytes(wrd_external_stx_to_bytes(wrd));
+    QCOMPARE(saved.lang, QString("USEN"));
+    QCOMPARE(saved.tables[0].ids, table.ids);
+    QCOMPARE(saved.tables[0].strings, wrd.strings);
+
+    // stx_ex text format, including empty and multi-line strings
+    const QStringList text_strings = QStringList() << "one" << "" << "two\nlines";
+    QStringList parsed_strings;
+    QString error;
+    QVERIFY(stx_strings_from_text(stx_strings_to_text(text_strings), parsed_strings, error));
+    QCOMPARE(parsed_strings, text_strings);
+    QVERIFY(stx_strings_from_text("##### 0002\r\nc\r\n\r\n##### 0000\r\na\r\nb\r\n", parsed_strings, error));
+    QCOMPARE(parsed_strings, QStringList() << "a\nb" << "" << "c");
+
+    // Indexes far beyond what the text could hold are rejected, as are non-ASCII digits
+    QVERIFY(!stx_strings_from_text("##### 99999999\nhuge\n", parsed_strings, error));
+    QVERIFY(!stx_strings_from_text("##### 99999999999999999999\nhuge\n", parsed_strings, error));
+    QVERIFY(!stx_strings_from_text("##### 5000\nshort\n", parsed_strings, error));
+    QVERIFY(stx_strings_from_text(QString::fromUtf8("##### \xD9\xA3\nx\n"), parsed_strings, error));
+    QCOMPARE(parsed_strings, QStringList() << "x");
+}
+
+void UnitTests::textIndexSearch()
+{
+    TextIndex index;
+    index.set_texts(0, QStringList() << "Hello there" << "Goodbye" << "HELLO again");
+    index.set_texts(1, QStringList() << "Well hello");
+
+    QVector<TextMatch> matches = index.find("hello");
+    QCOMPARE(matches.count(), 3);
+    QCOMPARE(matches.at(0).source, 0);
+    QCOMPARE(matches.at(0).index, 0);
+    QCOMPARE(matches.at(1).index, 2);
+    QCOMPARE(matches.at(2).source, 1);
+    QCOMPARE(index.text(matches.at(2)), QString("Well hello"));
+    QCOMPARE(index.find("hello", 1).count(), 1);
+
+    // Having every trigram isn't enough, they need to be in order
+    QCOMPARE(index.find("llohe").count(), 0);
+    // Short queries fall back to scanning
+    QCOMPARE(index.find("by").count(), 1);
+
+    // Only the changed entries are re-indexed, and removed entries stop matching
+    index.set_text(0, 1, "Hello, goodbye");
+    index.set_texts(0, QStringList() << "Hello there" << "Hello, goodbye");
+    QCOMPARE(index.find("hello").count(), 3);
+    QCOMPARE(index.find("again").count(), 0);
+    QCOMPARE(index.find("goodbye").count(), 1);
+
+    index.remove_source(0);
+    QCOMPARE(index.find("hello").count(), 1);
+}
+
+void UnitTests::statsScopes()
+{
+    const QByteArray dec_data = QByteArray("abcabcabcabc").repeated(64);
+
+    // Nothing is recorded until stats are enabled
+    spc_cmp(dec_data);
+    QVERIFY(stats_stages().isEmpty());
+
+    stats_enable(true);
+    const QByteArray cmp_data = spc_cmp(dec_data);
+    QCOMPARE(spc_dec(cmp_data, dec_data.size()), dec_data);
+    spc_dec(cmp_data, dec_data.size());
+
+    const QVector<StatsStage> stages = stats_stages();
+    QCOMPARE(stages.count(), 2);
+    QCOMPARE(stages.at(0).name, QByteArray("spc_cmp"));
+    QCOMPARE(stages.at(0).calls, (qint64)1);
+    QCOMPARE(stages.at(0).bytes_in, (qint64)dec_data.size());
+    QCOMPARE(stages.at(0).bytes_out, (qint64)cmp_data.size());
+    QCOMPARE(stages.at(1).name, QByteArray("spc_dec"));
+    QCOMPARE(stages.at(1).calls, (qint64)2);
+    QCOMPARE(stages.at(1).bytes_out, (qint64)dec_data.size() * 2);
+
+    QVERIFY(stats_report().contains("spc_dec"));
+    const QJsonObject json = QJsonDocument::fromJson(stats_to_json()).object();
+    QCOMPARE(json["stages"].toArray().count(), 2);
+    const QJsonObject trace = QJsonDocument::fromJson(stats_to_chrome_trace()).object();
+    QCOMPARE(trace["traceEvents"].toArray().count(), 3);
+
+    // Don't leave stats switched on for anything that runs after this
+    stats_disable();
+    stats_reset();
+    QVERIFY(!stats_enabled());
+    spc_cmp(dec_data);
+    QVERIFY(stats_stages().isEmpty());
+    QVERIFY(!stats_to_chrome_trace().contains("spc_cmp"));
+}
+
 QTEST_APPLESS_MAIN(UnitTests)
 
 #include "unit_tests.moc"
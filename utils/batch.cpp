@@ -0,0 +1,48 @@
+#include "batch.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QtConcurrent/QtConcurrent>
+
+void find_files(const QString &in_path, const QString &filter, const QString &out_dirpath, const QString &out_ext, QStringList &in_files, QStringList &out_files)
+{
+    QDirIterator it(in_path, QStringList() << filter, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext())
+        in_files.append(it.next());
+
+    in_files.sort();
+    for (const QString &in_file : in_files)
+    {
+        QString out_file = out_dirpath + '/' + QDir(in_path).relativeFilePath(in_file);
+        out_file = out_file.left(out_file.lastIndexOf('.')) + out_ext;
+        out_files.append(out_file);
+    }
+}
+
+int process_files(const QStringList &in_files, const QStringList &out_files, QString (*func)(const QString, const QString), const QString &root, const QString &verb)
+{
+    QVector<QFuture<QString>> results;
+    for (int i = 0; i < in_files.count(); i++)
+        results.append(QtConcurrent::run(func, in_files.at(i), out_files.at(i)));
+
+    int failed = 0;
+    for (int i = 0; i < in_files.count(); i++)
+    {
+        const QString error = results[i].result();
+
+        cout << verb << " file " << (i + 1) << "/" << in_files.count() << ": \"" << QDir(root).relativeFilePath(in_files.at(i)) << "\"\n";
+        if (!error.isEmpty())
+        {
+            cout << "Error: " << error << "\n";
+            failed++;
+        }
+        cout.flush();
+    }
+
+    if (failed > 0)
+    {
+        cout << failed << " of " << in_files.count() << " files failed.\n";
+        cout.flush();
+    }
+
+    return failed;
+}
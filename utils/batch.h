@@ -0,0 +1,19 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "utils_global.h"
+#include <QStringList>
+
+// Helpers shared by the command-line tools for converting whole directories of files.
+
+// Collects every file under "in_path" matching "filter" in sorted order, along with the
+// path it should be converted to under "out_dirpath", with its extension replaced by "out_ext".
+UTILS_EXPORT void find_files(const QString &in_path, const QString &filter, const QString &out_dirpath, const QString &out_ext, QStringList &in_files, QStringList &out_files);
+// Queues "func" for every (input, output) file pair on the global thread pool,
+// then reports each file as it finishes, always in the original (sorted) order,
+// so the output is identical no matter how the work was scheduled.
+// "func" returns an error message, or an empty string if it succeeded.
+// Returns the number of files which failed.
+UTILS_EXPORT int process_files(const QStringList &in_files, const QStringList &out_files, QString (*func)(const QString, const QString), const QString &root, const QString &verb);
+
+#endif // BATCH_H
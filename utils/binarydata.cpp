@@ -1,39 +1,39 @@
 #include "binarydata.h"
 
+#include <cstring>
+#include <QtAlgorithms>
+
 QString str_from_bytes(const QByteArray &data, int &pos, const int len, const QString codec)
 {
-    const int orig_pos = pos;
-
     if (codec.startsWith("UTF16", Qt::CaseInsensitive))
     {
-        QString result;
-        while (len < 0 || (pos - orig_pos) < len)
-        {
-            const ushort c = num_from_bytes<ushort>(data, pos);
+        // Find the null terminator first, then build the string in one go
+        const int avail_len = std::max(data.size() - pos, 0) / 2;
+        const int max_len = (len < 0) ? avail_len : std::min(avail_len, (len + 1) / 2);
+        const int str_len = utf16_len(data.constData() + pos, max_len);
 
-            if (c == 0)
-                break;
+        const QString result(reinterpret_cast<const QChar*>(data.constData() + pos), str_len);
 
-            result.append(QChar(c));
-        }
+        pos += str_len * 2;
+        if (str_len < max_len)
+            pos += 2;   // Skip the null terminator
 
         return result;
     }
     else
     {
-        QByteArray result;
+        // Same here, memchr() is a lot faster than checking one byte at a time
+        const int avail_len = std::max(data.size() - pos, 0);
+        const int max_len = (len < 0) ? avail_len : std::min(avail_len, len);
+        const char *start = data.constData() + pos;
+        const char *end = static_cast<const char*>(std::memchr(start, 0, max_len));
+        const int str_len = (end != nullptr) ? (int)(end - start) : max_len;
 
-        while (pos < data.size() && (len < 0 || (pos - orig_pos) < len))
-        {
-            const char c = data.at(pos++);
+        pos += str_len;
+        if (str_len < max_len)
+            pos++;      // Skip the null terminator
 
-            if (c == 0)
-                break;
-
-            result.append(c);
-        }
-
-        return QString::fromUtf8(result);
+        return QString::fromUtf8(start, str_len);
     }
 }
 
@@ -68,3 +68,28 @@ QString num_to_hex(const ulong num, const uchar pad_len)
 {
     return QString::number(num, 16).toUpper().rightJustified(pad_len, '0');
 }
+
+int utf16_len(const char *data, const int max_len)
+{
+    int i = 0;
+
+#ifdef UTILS_SSE2
+    // 8 code units at a time
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= max_len; i += 8)
+    {
+        const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + (i * 2)));
+        const uint mask = (uint)_mm_movemask_epi8(_mm_cmpeq_epi16(chars, zero));
+        if (mask != 0)
+            return i + (qCountTrailingZeroBits(mask) / 2);
+    }
+#endif
+
+    for (; i < max_len; ++i)
+    {
+        if (data[i * 2] == 0 && data[(i * 2) + 1] == 0)
+            return i;
+    }
+
+    return max_len;
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "utils_global.h"
+#include <algorithm>
 #include <cmath>
 #include <QByteArray>
 #include <QVector>
@@ -10,6 +11,9 @@ UTILS_EXPORT QString str_from_bytes(const QByteArray &data, int &pos, const int
 UTILS_EXPORT QByteArray str_to_bytes(const QString &string, const bool utf16 = false);
 UTILS_EXPORT QByteArray get_bytes(const QByteArray &data, int &pos, const int len = -1);
 UTILS_EXPORT QString num_to_hex(const ulong num, const uchar pad_len);
+// Length (in code units) of the null-terminated UTF-16 string at "data",
+// looking no further than "max_len" code units.
+UTILS_EXPORT int utf16_len(const char *data, const int max_len);
 
 template <typename T> T num_from_bytes(const QByteArray &data, int &pos, const bool big_endian = false)
 {
@@ -59,3 +63,18 @@ template <typename T> QByteArray num_to_bytes(T num, const bool big_endian = fal
     //delete byte_array;
     return result;
 }
+
+// Write a number straight into a preallocated buffer, advancing pos.
+// Useful when the final output size is known in advance and we don't
+// want to build it up one small QByteArray at a time.
+template <typename T> void num_to_buf(T num, char *buf, int &pos, const bool big_endian = false)
+{
+    const char *byte_array = reinterpret_cast<const char*>(&num);
+
+    if (big_endian)
+        std::reverse_copy(byte_array, byte_array + sizeof(T), buf + pos);
+    else
+        std::copy(byte_array, byte_array + sizeof(T), buf + pos);
+
+    pos += sizeof(T);
+}
@@ -3,6 +3,19 @@
 DatFile dat_from_bytes(const QByteArray &bytes)
 {
     DatFile result;
+    QString error;
+    if (!dat_from_bytes(bytes, result, error))
+    {
+        cout << "Error: " << error << "\n";
+        cout.flush();
+        throw 1;
+    }
+    return result;
+}
+
+bool dat_from_bytes(const QByteArray &bytes, DatFile &result, QString &error)
+{
+    result = DatFile();
 
     int pos = 0;
     const int struct_count = num_from_bytes<int>(bytes, pos);
@@ -11,9 +24,8 @@ DatFile dat_from_bytes(const QByteArray &bytes)
 
     if (struct_count <= 0 || struct_size <= 0 || var_count <= 0)
     {
-        cout << "Error: Invalid DAT file.\n";
-        cout.flush();
-        throw 1;
+        error = "Invalid DAT file.";
+        return false;
     }
 
     for (int v = 0; v < var_count; ++v)
@@ -27,32 +39,22 @@ DatFile dat_from_bytes(const QByteArray &bytes)
 
     pos += (0x10 - (pos % 0x10)) % 0x10;
 
-    for (int d = 0; d < struct_count; ++d)
+    // The structs are stored back-to-back, exactly as we keep them in memory.
+    dat_build_columns(result);
+    // Multiply in 64 bits, so a huge struct count can't wrap around and pass the size check
+    const qint64 data_size = (qint64)struct_count * result.struct_size;
+    if (data_size > (qint64)bytes.size() - pos)
     {
-        QVector<QByteArray> data;
-        for (int v = 0; v < result.data_types.count(); ++v)
-        {
-            const QString data_type = result.data_types.at(v);
-            QByteArray var;
-
-            if (data_type.startsWith("u") || data_type.startsWith("s") || data_type.startsWith("f"))
-            {
-                const int size = data_type.right(2).toInt() / 8;
-                var = get_bytes(bytes, pos, size);
-                data.append(var);
-            }
-            else if (data_type == "LABEL" || data_type == "REFER" || data_type == "ASCII" || data_type == "UTF16")
-            {
-                var = get_bytes(bytes, pos, 2);
-                data.append(var);
-            }
-        }
-        result.data.append(data);
+        error = "Invalid DAT file.";
+        return false;
     }
+    result.data = bytes.mid(pos, (int)data_size);
+    pos += (int)data_size;
 
     const ushort label_count = num_from_bytes<ushort>(bytes, pos);
     const ushort refer_count = num_from_bytes<ushort>(bytes, pos);
 
+    result.labels.reserve(label_count);
     for (ushort s = 0; s < label_count; ++s)
     {
         const QString str = str_from_bytes(bytes, pos);
@@ -61,37 +63,47 @@ DatFile dat_from_bytes(const QByteArray &bytes)
 
     pos += (2 - (pos % 2)) % 2;
 
+    // Scan straight to each terminator and build the string in one go
+    result.refs.reserve(refer_count);
     for (ushort r = 0; r < refer_count; r++)
     {
-        QByteArray unk;
+        const int max_len = std::max(bytes.size() - pos, 0) / 2;
+        const int str_len = utf16_len(bytes.constData() + pos, max_len);
+        result.refs.append(QString(reinterpret_cast<const QChar*>(bytes.constData() + pos), str_len));
 
-        uchar c1, c2;
-        do
-        {
-            c1 = bytes.at(pos++);
-            c2 = bytes.at(pos++);
-            unk.append(c1);
-            unk.append(c2);
-
-        } while (c1 != 0 || c2 != 0);
-
-        int str_pos = 0;
-        result.refs.append(str_from_bytes(unk, str_pos, -1, "UTF16LE"));
+        pos += (str_len + 1) * 2;   // Skip the null terminator
     }
 
-    return result;
+    return true;
 }
 
 QByteArray dat_to_bytes(const DatFile &dat_file)
 {
     QByteArray result;
+    QString error;
+    if (!dat_to_bytes(dat_file, result, error))
+    {
+        cout << "Error: " << error << "\n";
+        cout.flush();
+        throw 1;
+    }
+    return result;
+}
 
-    int struct_size = 0;
-    for (int s = 0; s < dat_file.data.at(0).count(); ++s)
-        struct_size += dat_file.data.at(0).at(s).size();
+bool dat_to_bytes(const DatFile &dat_file, QByteArray &result, QString &error)
+{
+    // Both counts are stored as ushorts
+    if (dat_file.labels.count() > 0xFFFF || dat_file.refs.count() > 0xFFFF)
+    {
+        error = "Too many strings (" + QString::number(dat_file.labels.count()) + " labels, "
+                + QString::number(dat_file.refs.count()) + " refs), the limit is 65535 of each.";
+        return false;
+    }
+
+    result.clear();
 
-    result.append(num_to_bytes<uint>(dat_file.data.count()));       // struct_count
-    result.append(num_to_bytes<uint>(struct_size));                 // struct_size
+    result.append(num_to_bytes<uint>(dat_row_count(dat_file)));     // struct_count
+    result.append(num_to_bytes<uint>(dat_file.struct_size));        // struct_size
     result.append(num_to_bytes<uint>(dat_file.data_types.count())); // var_count
 
     for (int v = 0; v < dat_file.data_types.count(); ++v)
@@ -104,13 +116,7 @@ QByteArray dat_to_bytes(const DatFile &dat_file)
 
     result.append((0x10 - (result.size() % 0x10)) % 0x10, 0x00);    // padding
 
-    for (int d = 0; d < dat_file.data.count(); ++d)
-    {
-        for (int v = 0; v < dat_file.data_types.count(); ++v)
-        {
-            result.append(dat_file.data.at(d).at(v));
-        }
-    }
+    result.append(dat_file.data);
 
     result.append(num_to_bytes<ushort>(dat_file.labels.count()));
     result.append(num_to_bytes<ushort>(dat_file.refs.count()));
@@ -127,5 +133,310 @@ QByteArray dat_to_bytes(const DatFile &dat_file)
         result.append(str_to_bytes(ref, true));
     }
 
-    return result;
+    return true;
+}
+
+DatType dat_type_from_string(const QString &type)
+{
+    if (type == "LABEL")
+        return DAT_TYPE_LABEL;
+    else if (type == "ASCII")
+        return DAT_TYPE_ASCII;
+    else if (type == "REFER")
+        return DAT_TYPE_REFER;
+    else if (type == "UTF16")
+        return DAT_TYPE_UTF16;
+
+    const int bits = type.mid(1).toInt();
+    if (type.startsWith("u"))
+    {
+        switch (bits)
+        {
+        case 8:  return DAT_TYPE_U8;
+        case 16: return DAT_TYPE_U16;
+        case 32: return DAT_TYPE_U32;
+        case 64: return DAT_TYPE_U64;
+        }
+    }
+    else if (type.startsWith("s"))
+    {
+        switch (bits)
+        {
+        case 8:  return DAT_TYPE_S8;
+        case 16: return DAT_TYPE_S16;
+        case 32: return DAT_TYPE_S32;
+        case 64: return DAT_TYPE_S64;
+        }
+    }
+    else if (type.startsWith("f"))
+    {
+        switch (bits)
+        {
+        case 32: return DAT_TYPE_F32;
+        case 64: return DAT_TYPE_F64;
+        }
+    }
+
+    return DAT_TYPE_UNKNOWN;
+}
+
+int dat_type_size(const DatType type)
+{
+    switch (type)
+    {
+    case DAT_TYPE_U8:
+    case DAT_TYPE_S8:
+        return 1;
+    case DAT_TYPE_U16:
+    case DAT_TYPE_S16:
+    case DAT_TYPE_LABEL:
+    case DAT_TYPE_ASCII:
+    case DAT_TYPE_REFER:
+    case DAT_TYPE_UTF16:
+        return 2;
+    case DAT_TYPE_U32:
+    case DAT_TYPE_S32:
+    case DAT_TYPE_F32:
+        return 4;
+    case DAT_TYPE_U64:
+    case DAT_TYPE_S64:
+    case DAT_TYPE_F64:
+        return 8;
+    case DAT_TYPE_UNKNOWN:
+        break;
+    }
+
+    return 0;
+}
+
+void dat_build_columns(DatFile &dat)
+{
+    dat.columns.clear();
+    dat.columns.reserve(dat.data_types.count());
+
+    int offset = 0;
+    for (const QString &type : dat.data_types)
+    {
+        DatColumn column;
+        column.type = dat_type_from_string(type);
+        column.offset = offset;
+        column.size = dat_type_size(column.type);
+        dat.columns.append(column);
+        offset += column.size;
+    }
+    dat.struct_size = offset;
+}
+
+int dat_row_count(const DatFile &dat)
+{
+    if (dat.struct_size <= 0)
+        return 0;
+
+    return dat.data.size() / dat.struct_size;
+}
+
+void dat_insert_rows(DatFile &dat, const int row, const int count)
+{
+    dat.data.insert(row * dat.struct_size, QByteArray(count * dat.struct_size, 0x00));
+}
+
+void dat_remove_rows(DatFile &dat, const int row, const int count)
+{
+    dat.data.remove(row * dat.struct_size, count * dat.struct_size);
+}
+
+void dat_move_row(DatFile &dat, const int from, const int to)
+{
+    const QByteArray moved = dat.data.mid(from * dat.struct_size, dat.struct_size);
+    dat.data.remove(from * dat.struct_size, dat.struct_size);
+    dat.data.insert(to * dat.struct_size, moved);
+}
+
+QByteArray dat_cell(const DatFile &dat, const int row, const int col)
+{
+    return dat.data.mid((row * dat.struct_size) + dat.columns.at(col).offset, dat.columns.at(col).size);
+}
+
+void dat_set_cell(DatFile &dat, const int row, const int col, const QByteArray &val)
+{
+    const DatColumn &column = dat.columns.at(col);
+    std::copy(val.constData(), val.constData() + std::min(val.size(), column.size), dat.data.data() + (row * dat.struct_size) + column.offset);
+}
+
+QString dat_value_to_string(const DatFile &dat, const int row, const int col, const bool resolve_strings)
+{
+    switch (dat.columns.at(col).type)
+    {
+    case DAT_TYPE_U8:
+        return QString::number(dat_value<uchar>(dat, row, col));
+    case DAT_TYPE_U16:
+        return QString::number(dat_value<ushort>(dat, row, col));
+    case DAT_TYPE_U32:
+        return QString::number(dat_value<uint>(dat, row, col));
+    case DAT_TYPE_U64:
+        return QString::number(dat_value<qulonglong>(dat, row, col));
+    case DAT_TYPE_S8:
+        return QString::number(dat_value<qint8>(dat, row, col));
+    case DAT_TYPE_S16:
+        return QString::number(dat_value<short>(dat, row, col));
+    case DAT_TYPE_S32:
+        return QString::number(dat_value<int>(dat, row, col));
+    case DAT_TYPE_S64:
+        return QString::number(dat_value<qlonglong>(dat, row, col));
+    case DAT_TYPE_F32:
+        return QString::number(dat_value<float>(dat, row, col));
+    case DAT_TYPE_F64:
+        return QString::number(dat_value<double>(dat, row, col));
+    case DAT_TYPE_LABEL:
+    case DAT_TYPE_ASCII:
+    case DAT_TYPE_REFER:
+    {
+        const ushort label_index = dat_value<ushort>(dat, row, col);
+        if (resolve_strings && label_index < dat.labels.count())
+            return dat.labels.at(label_index);
+        return QString::number(label_index, 16);
+    }
+    case DAT_TYPE_UTF16:
+    {
+        const ushort string_index = dat_value<ushort>(dat, row, col);
+        if (resolve_strings && string_index < dat.refs.count())
+            return dat.refs.at(string_index);
+        return QString::number(string_index, 16);
+    }
+    case DAT_TYPE_UNKNOWN:
+        break;
+    }
+
+    return QString();
+}
+
+QVariant dat_value_to_variant(const DatFile &dat, const int row, const int col)
+{
+    switch (dat.columns.at(col).type)
+    {
+    case DAT_TYPE_U8:
+        return (uint)dat_value<uchar>(dat, row, col);
+    case DAT_TYPE_U16:
+        return (uint)dat_value<ushort>(dat, row, col);
+    case DAT_TYPE_U32:
+        return dat_value<uint>(dat, row, col);
+    case DAT_TYPE_U64:
+        return dat_value<qulonglong>(dat, row, col);
+    case DAT_TYPE_S8:
+        return (int)dat_value<qint8>(dat, row, col);
+    case DAT_TYPE_S16:
+        return (int)dat_value<short>(dat, row, col);
+    case DAT_TYPE_S32:
+        return dat_value<int>(dat, row, col);
+    case DAT_TYPE_S64:
+        return dat_value<qlonglong>(dat, row, col);
+    case DAT_TYPE_F32:
+        return dat_value<float>(dat, row, col);
+    case DAT_TYPE_F64:
+        return dat_value<double>(dat, row, col);
+    case DAT_TYPE_LABEL:
+    case DAT_TYPE_ASCII:
+    case DAT_TYPE_REFER:
+    case DAT_TYPE_UTF16:
+        return (uint)dat_value<ushort>(dat, row, col);
+    case DAT_TYPE_UNKNOWN:
+        break;
+    }
+
+    return QVariant();
+}
+
+bool dat_value_from_string(DatFile &dat, const int row, const int col, const QString &text)
+{
+    bool ok = false;
+    switch (dat.columns.at(col).type)
+    {
+    case DAT_TYPE_U8:
+    {
+        const ushort val = text.toUShort(&ok);
+        ok = ok && val <= 0xFF;
+        if (ok)
+            dat_set_value<uchar>(dat, row, col, val);
+        break;
+    }
+    case DAT_TYPE_U16:
+    {
+        const ushort val = text.toUShort(&ok);
+        if (ok)
+            dat_set_value(dat, row, col, val);
+        break;
+    }
+    case DAT_TYPE_U32:
+    {
+        const uint val = text.toUInt(&ok);
+        if (ok)
+            dat_set_value(dat, row, col, val);
+        break;
+    }
+    case DAT_TYPE_U64:
+    {
+        const qulonglong val = text.toULongLong(&ok);
+        if (ok)
+            dat_set_value(dat, row, col, val);
+        break;
+    }
+    case DAT_TYPE_S8:
+    {
+        const short val = text.toShort(&ok);
+        ok = ok && val >= -0x80 && val <= 0x7F;
+        if (ok)
+            dat_set_value<qint8>(dat, row, col, val);
+        break;
+    }
+    case DAT_TYPE_S16:
+    {
+        const short val = text.toShort(&ok);
+        if (ok)
+            dat_set_value(dat, row, col, val);
+        break;
+    }
+    case DAT_TYPE_S32:
+    {
+        const int val = text.toInt(&ok);
+        if (ok)
+            dat_set_value(dat, row, col, val);
+        break;
+    }
+    case DAT_TYPE_S64:
+    {
+        const qlonglong val = text.toLongLong(&ok);
+        if (ok)
+            dat_set_value(dat, row, col, val);
+        break;
+    }
+    case DAT_TYPE_F32:
+    {
+        const float val = text.toFloat(&ok);
+        if (ok)
+            dat_set_value(dat, row, col, val);
+        break;
+    }
+    case DAT_TYPE_F64:
+    {
+        const double val = text.toDouble(&ok);
+        if (ok)
+            dat_set_value(dat, row, col, val);
+        break;
+    }
+    case DAT_TYPE_LABEL:
+    case DAT_TYPE_ASCII:
+    case DAT_TYPE_REFER:
+    case DAT_TYPE_UTF16:
+    {
+        // Same base that dat_value_to_string() uses for unresolved indexes
+        const ushort val = text.toUShort(&ok, 16);
+        if (ok)
+            dat_set_value(dat, row, col, val);
+        break;
+    }
+    case DAT_TYPE_UNKNOWN:
+        break;
+    }
+
+    return ok;
 }
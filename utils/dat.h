@@ -3,18 +3,89 @@
 
 #include "utils_global.h"
 #include "binarydata.h"
+#include <QVariant>
+
+enum DatType
+{
+    DAT_TYPE_UNKNOWN,
+    DAT_TYPE_U8,
+    DAT_TYPE_U16,
+    DAT_TYPE_U32,
+    DAT_TYPE_U64,
+    DAT_TYPE_S8,
+    DAT_TYPE_S16,
+    DAT_TYPE_S32,
+    DAT_TYPE_S64,
+    DAT_TYPE_F32,
+    DAT_TYPE_F64,
+    DAT_TYPE_LABEL,     // LABEL, ASCII and REFER are indexes into DatFile::labels
+    DAT_TYPE_ASCII,
+    DAT_TYPE_REFER,
+    DAT_TYPE_UTF16      // Index into DatFile::refs
+};
+
+struct UTILS_EXPORT DatColumn
+{
+    DatType type;
+    int offset;     // Byte offset of this value within each struct
+    int size;       // Size of this value in bytes
+};
 
 struct UTILS_EXPORT DatFile
 {
     QString filename;
     QStringList data_names;
     QStringList data_types; // var_name, var_type, 0x0100 (var count + null terminator?)
-    QVector<QVector<QByteArray>> data;
+    QVector<DatColumn> columns; // Built from data_types by dat_build_columns()
+    int struct_size = 0;
+    QByteArray data;            // Every struct stored back-to-back, struct_size bytes each
     QStringList labels;
     QStringList refs;
 };
 
 UTILS_EXPORT DatFile dat_from_bytes(const QByteArray &bytes);
+// Same as above, but returns false and sets "error" instead of printing it and throwing,
+// so it's safe to call from worker threads.
+UTILS_EXPORT bool dat_from_bytes(const QByteArray &bytes, DatFile &dat, QString &error);
+// Throws if there are more than 0xFFFF labels or refs.
 UTILS_EXPORT QByteArray dat_to_bytes(const DatFile &dat);
+// Same as above, but returns false and sets "error" instead of printing it and throwing,
+// so it's safe to call from worker threads.
+UTILS_EXPORT bool dat_to_bytes(const DatFile &dat, QByteArray &bytes, QString &error);
+UTILS_EXPORT DatType dat_type_from_string(const QString &type);
+UTILS_EXPORT int dat_type_size(const DatType type);
+// Must be called whenever data_types changes.
+UTILS_EXPORT void dat_build_columns(DatFile &dat);
+UTILS_EXPORT int dat_row_count(const DatFile &dat);
+UTILS_EXPORT void dat_insert_rows(DatFile &dat, const int row, const int count);
+UTILS_EXPORT void dat_remove_rows(DatFile &dat, const int row, const int count);
+UTILS_EXPORT void dat_move_row(DatFile &dat, const int from, const int to);
+UTILS_EXPORT QByteArray dat_cell(const DatFile &dat, const int row, const int col);
+UTILS_EXPORT void dat_set_cell(DatFile &dat, const int row, const int col, const QByteArray &val);
+// String indexes are written in hex, or as the string they point to if "resolve_strings" is true.
+UTILS_EXPORT QString dat_value_to_string(const DatFile &dat, const int row, const int col, const bool resolve_strings = false);
+// Numbers come back as their natural type (uint, qlonglong, double, etc.), and strings as their index.
+UTILS_EXPORT QVariant dat_value_to_variant(const DatFile &dat, const int row, const int col);
+// Returns false (leaving the value untouched) if "text" isn't valid for the column's type.
+UTILS_EXPORT bool dat_value_from_string(DatFile &dat, const int row, const int col, const QString &text);
+
+template <typename T> T dat_value(const DatFile &dat, const int row, const int col)
+{
+    const DatColumn &column = dat.columns.at(col);
+    const char *src = dat.data.constData() + (row * dat.struct_size) + column.offset;
+
+    T result = 0;
+    std::copy(src, src + std::min((int)sizeof(T), column.size), reinterpret_cast<char*>(&result));
+    return result;
+}
+
+template <typename T> void dat_set_value(DatFile &dat, const int row, const int col, const T value)
+{
+    const DatColumn &column = dat.columns.at(col);
+    char *dest = dat.data.data() + (row * dat.struct_size) + column.offset;
+
+    const char *src = reinterpret_cast<const char*>(&value);
+    std::copy(src, src + std::min((int)sizeof(T), column.size), dest);
+}
 
 #endif // DAT_H
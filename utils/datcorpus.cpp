@@ -0,0 +1,227 @@
+#include "datcorpus.h"
+#include <cstring>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QHash>
+#include <QtConcurrent/QtConcurrent>
+
+DatCorpus dat_corpus_load(const QString &dirpath)
+{
+    DatCorpus corpus;
+    corpus.root = dirpath;
+
+    QDirIterator it(dirpath, QStringList() << "*.dat", QDir::Files, QDirIterator::Subdirectories);
+    QStringList filepaths;
+    while (it.hasNext())
+        filepaths.append(it.next());
+    filepaths.sort();
+
+    QVector<int> indexes;
+    for (int i = 0; i < filepaths.count(); ++i)
+        indexes.append(i);
+
+    // Each file only ever writes to its own slot, so no locking is needed.
+    // Errors are collected rather than printed, so they don't get interleaved.
+    QVector<DatFile> loaded(filepaths.count());
+    QVector<QString> load_errors(filepaths.count());
+    DatFile *loaded_data = loaded.data();
+    QString *error_data = load_errors.data();
+    QtConcurrent::blockingMap(indexes, [&](const int &i) {
+        QFile f(filepaths.at(i));
+        if (!f.open(QFile::ReadOnly))
+        {
+            error_data[i] = "Failed to open file.";
+            return;
+        }
+        const QByteArray bytes = f.readAll();
+        f.close();
+
+        if (dat_from_bytes(bytes, loaded_data[i], error_data[i]))
+            loaded_data[i].filename = QDir(dirpath).relativeFilePath(filepaths.at(i));
+        else if (error_data[i].isEmpty())
+            error_data[i] = "Invalid DAT file.";
+    });
+
+    // Intern the schemas in file order, so the result doesn't depend on thread scheduling.
+    QHash<QString, int> schema_indexes;
+    for (int i = 0; i < filepaths.count(); ++i)
+    {
+        if (!load_errors.at(i).isEmpty())
+        {
+            corpus.errors.append(QDir(dirpath).relativeFilePath(filepaths.at(i)) + ": " + load_errors.at(i));
+            continue;
+        }
+
+        DatFile &dat = loaded[i];
+        const QString key = dat.data_names.join('\n') + '\t' + dat.data_types.join('\n');
+
+        int schema_index = schema_indexes.value(key, -1);
+        if (schema_index < 0)
+        {
+            DatSchema schema;
+            schema.data_names = dat.data_names;
+            schema.data_types = dat.data_types;
+            schema.columns = dat.columns;
+            schema.struct_size = dat.struct_size;
+
+            schema_index = corpus.schemas.count();
+            corpus.schemas.append(schema);
+            schema_indexes.insert(key, schema_index);
+        }
+
+        // Drop this file's own copies in favour of the shared ones
+        const DatSchema &schema = corpus.schemas.at(schema_index);
+        dat.data_names = schema.data_names;
+        dat.data_types = schema.data_types;
+        dat.columns = schema.columns;
+
+        corpus.files.append(dat);
+        corpus.file_schemas.append(schema_index);
+    }
+
+    return corpus;
+}
+
+// Floats are shown rounded to 6 significant digits, so a row matches if it's either exactly
+// the value searched for, or shows up as the same text. Other number types are exact.
+struct FloatQuery
+{
+    bool valid = false;
+    double value = 0;
+    QString text;
+
+    bool matches(const double row_value) const
+    {
+        if (row_value == value)
+            return true;
+
+        // Only format values that are close enough to possibly round the same way
+        const double diff = std::abs(row_value - value);
+        return diff <= std::max(std::abs(row_value), std::abs(value)) * 1e-5 && QString::number(row_value) == text;
+    }
+};
+
+QVector<DatMatch> dat_corpus_find(const DatCorpus &corpus, const QString &column, const QString &value)
+{
+    FloatQuery float_query;
+    float_query.value = value.trimmed().toDouble(&float_query.valid);
+    float_query.text = QString::number(float_query.value);
+
+    // Work out what we're looking for once per schema, rather than once per file or row.
+    QVector<int> schema_cols(corpus.schemas.count(), -1);
+    QVector<QByteArray> schema_values(corpus.schemas.count());
+    QVector<bool> schema_strings(corpus.schemas.count(), false);
+    QVector<bool> schema_floats(corpus.schemas.count(), false);
+    for (int s = 0; s < corpus.schemas.count(); ++s)
+    {
+        const DatSchema &schema = corpus.schemas.at(s);
+        const int col = schema.data_names.indexOf(column);
+        if (col < 0)
+            continue;
+
+        const DatType type = schema.columns.at(col).type;
+        if (type == DAT_TYPE_LABEL || type == DAT_TYPE_ASCII || type == DAT_TYPE_REFER || type == DAT_TYPE_UTF16)
+        {
+            schema_cols[s] = col;
+            schema_strings[s] = true;
+            continue;
+        }
+
+        if (type == DAT_TYPE_F32 || type == DAT_TYPE_F64)
+        {
+            if (!float_query.valid)
+                continue;
+
+            schema_cols[s] = col;
+            schema_floats[s] = true;
+            continue;
+        }
+
+        // Encode the value exactly as it would be stored, so rows can be compared byte-for-byte.
+        DatFile probe;
+        probe.data_types = schema.data_types;
+        probe.columns = schema.columns;
+        probe.struct_size = schema.struct_size;
+        probe.data = QByteArray(schema.struct_size, 0x00);
+        if (!dat_value_from_string(probe, 0, col, value))
+            continue;
+
+        schema_cols[s] = col;
+        schema_values[s] = dat_cell(probe, 0, col);
+    }
+
+    QVector<DatMatch> matches;
+    for (int f = 0; f < corpus.files.count(); ++f)
+    {
+        const int s = corpus.file_schemas.at(f);
+        const int col = schema_cols.at(s);
+        if (col < 0)
+            continue;
+
+        const DatFile &dat = corpus.files.at(f);
+        const DatColumn &dat_col = dat.columns.at(col);
+        const int row_count = dat_row_count(dat);
+
+        if (schema_strings.at(s))
+        {
+            // String column: find which indexes point at the text, then match the indexes.
+            const QStringList &strings = (dat_col.type == DAT_TYPE_UTF16) ? dat.refs : dat.labels;
+            QVector<bool> wanted(strings.count(), false);
+            bool any_wanted = false;
+            for (int i = 0; i < strings.count(); ++i)
+            {
+                if (strings.at(i) == value)
+                {
+                    wanted[i] = true;
+                    any_wanted = true;
+                }
+            }
+            if (!any_wanted)
+                continue;
+
+            for (int row = 0; row < row_count; ++row)
+            {
+                const ushort index = dat_value<ushort>(dat, row, col);
+                if (index < wanted.count() && wanted.at(index))
+                {
+                    DatMatch match;
+                    match.file = f;
+                    match.row = row;
+                    matches.append(match);
+                }
+            }
+        }
+        else if (schema_floats.at(s))
+        {
+            for (int row = 0; row < row_count; ++row)
+            {
+                const double row_value = (dat_col.type == DAT_TYPE_F32) ? dat_value<float>(dat, row, col) : dat_value<double>(dat, row, col);
+                if (float_query.matches(row_value))
+                {
+                    DatMatch match;
+                    match.file = f;
+                    match.row = row;
+                    matches.append(match);
+                }
+            }
+        }
+        else
+        {
+            const char *wanted = schema_values.at(s).constData();
+            const char *cell = dat.data.constData() + dat_col.offset;
+            for (int row = 0; row < row_count; ++row, cell += dat.struct_size)
+            {
+                if (std::memcmp(cell, wanted, dat_col.size) == 0)
+                {
+                    DatMatch match;
+                    match.file = f;
+                    match.row = row;
+                    matches.append(match);
+                }
+            }
+        }
+    }
+
+    return matches;
+}
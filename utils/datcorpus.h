@@ -0,0 +1,39 @@
+#ifndef DATCORPUS_H
+#define DATCORPUS_H
+
+#include "utils_global.h"
+#include "dat.h"
+
+// A set of columns shared by one or more DAT files.
+struct UTILS_EXPORT DatSchema
+{
+    QStringList data_names;
+    QStringList data_types;
+    QVector<DatColumn> columns;
+    int struct_size = 0;
+};
+
+// Every DAT file under a directory. Files with identical columns share a single
+// DatSchema, and their data_names/data_types/columns share that schema's data.
+struct UTILS_EXPORT DatCorpus
+{
+    QString root;
+    QVector<DatSchema> schemas;
+    QVector<DatFile> files;         // DatFile::filename is relative to "root"
+    QVector<int> file_schemas;      // Index into "schemas" for each file
+    QStringList errors;             // "filename: error" for each file which couldn't be loaded
+};
+
+struct UTILS_EXPORT DatMatch
+{
+    int file;
+    int row;
+};
+
+UTILS_EXPORT DatCorpus dat_corpus_load(const QString &dirpath);
+// Finds every row (in any file) with a column named "column" whose value is "value".
+// Numbers are compared by value and string columns by the text they point to.
+// Floats also match if they'd be displayed as the same text (6 significant digits).
+UTILS_EXPORT QVector<DatMatch> dat_corpus_find(const DatCorpus &corpus, const QString &column, const QString &value);
+
+#endif // DATCORPUS_H
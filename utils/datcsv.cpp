@@ -0,0 +1,508 @@
+#include "datcsv.h"
+#include <QHash>
+
+static void append_uint(QByteArray &csv, quint64 value)
+{
+    char buf[20];
+    int len = 0;
+    do
+    {
+        buf[len++] = '0' + (value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    std::reverse(buf, buf + len);
+    csv.append(buf, len);
+}
+
+static void append_int(QByteArray &csv, const qint64 value)
+{
+    if (value < 0)
+    {
+        csv.append('-');
+        append_uint(csv, 0 - (quint64)value);
+    }
+    else
+    {
+        append_uint(csv, (quint64)value);
+    }
+}
+
+// Use the shortest text that reads back as exactly the same value,
+// so a round trip through a spreadsheet doesn't slowly change the data.
+static void append_float(QByteArray &csv, const double value, const bool single)
+{
+    for (int precision = 6; precision < 17; precision++)
+    {
+        const QByteArray text = QByteArray::number(value, 'g', precision);
+        if (single ? (text.toFloat() == (float)value) : (text.toDouble() == value))
+        {
+            csv.append(text);
+            return;
+        }
+    }
+    csv.append(QByteArray::number(value, 'g', 17));
+}
+
+static void append_quoted(QByteArray &csv, const QByteArray &text)
+{
+    csv.append('"');
+    if (text.contains('"'))
+        csv.append(QByteArray(text).replace("\"", "\"\""));
+    else
+        csv.append(text);
+    csv.append('"');
+}
+
+// The index of the first copy of each string, since only those can be looked up by text.
+static QHash<QString, int> first_indexes(const QStringList &strings)
+{
+    QHash<QString, int> result;
+    result.reserve(strings.count());
+    for (int i = 0; i < strings.count(); ++i)
+    {
+        if (!result.contains(strings.at(i)))
+            result.insert(strings.at(i), i);
+    }
+    return result;
+}
+
+static void append_string_index(QByteArray &csv, const ushort index, const QStringList &strings, const QHash<QString, int> &firsts)
+{
+    if (index < strings.count() && !strings.at(index).startsWith('#') && firsts.value(strings.at(index)) == index)
+    {
+        append_quoted(csv, strings.at(index).toUtf8());
+    }
+    else
+    {
+        csv.append('#');
+        append_uint(csv, index);
+    }
+}
+
+static void append_string_table(QByteArray &csv, const QByteArray &name, const QStringList &strings)
+{
+    csv.append(name);
+    csv.append('\n');
+    for (int i = 0; i < strings.count(); ++i)
+    {
+        append_uint(csv, i);
+        csv.append(',');
+        append_quoted(csv, strings.at(i).toUtf8());
+        csv.append('\n');
+    }
+}
+
+QByteArray dat_to_csv(const DatFile &dat)
+{
+    const int row_count = dat_row_count(dat);
+    const int col_count = dat.columns.count();
+
+    const QHash<QString, int> label_firsts = first_indexes(dat.labels);
+    const QHash<QString, int> ref_firsts = first_indexes(dat.refs);
+
+    QByteArray csv;
+    csv.reserve((row_count + 1) * col_count * 8);
+
+    for (int col = 0; col < col_count; ++col)
+    {
+        if (col > 0)
+            csv.append(',');
+        csv.append(dat.data_names.at(col).toUtf8() + ' ' + dat.data_types.at(col).toUtf8());
+    }
+    csv.append('\n');
+
+    for (int row = 0; row < row_count; ++row)
+    {
+        for (int col = 0; col < col_count; ++col)
+        {
+            if (col > 0)
+                csv.append(',');
+
+            const DatColumn &column = dat.columns.at(col);
+            switch (column.type)
+            {
+            case DAT_TYPE_U8:
+            case DAT_TYPE_U16:
+            case DAT_TYPE_U32:
+            case DAT_TYPE_U64:
+                append_uint(csv, dat_value<quint64>(dat, row, col));
+                break;
+            case DAT_TYPE_S8:
+            case DAT_TYPE_S16:
+            case DAT_TYPE_S32:
+            case DAT_TYPE_S64:
+            {
+                // Only the column's own bytes are read, so extend the sign bit by hand
+                const int shift = 64 - (column.size * 8);
+                const qint64 value = (qint64)(dat_value<quint64>(dat, row, col) << shift) >> shift;
+                append_int(csv, value);
+                break;
+            }
+            case DAT_TYPE_F32:
+                append_float(csv, dat_value<float>(dat, row, col), true);
+                break;
+            case DAT_TYPE_F64:
+                append_float(csv, dat_value<double>(dat, row, col), false);
+                break;
+            case DAT_TYPE_LABEL:
+            case DAT_TYPE_ASCII:
+            case DAT_TYPE_REFER:
+                append_string_index(csv, dat_value<ushort>(dat, row, col), dat.labels, label_firsts);
+                break;
+            case DAT_TYPE_UTF16:
+                append_string_index(csv, dat_value<ushort>(dat, row, col), dat.refs, ref_firsts);
+                break;
+            case DAT_TYPE_UNKNOWN:
+                break;
+            }
+        }
+        csv.append('\n');
+    }
+
+    append_string_table(csv, "#LABELS", dat.labels);
+    append_string_table(csv, "#REFS", dat.refs);
+
+    return csv;
+}
+
+// Reads the field starting at "pos" into "field" and moves past its separator.
+// "line_end" is set if this was the last field on its line.
+static void read_field(const char *data, const int len, int &pos, QByteArray &field, bool &quoted, bool &line_end)
+{
+    field.resize(0);
+    quoted = (pos < len && data[pos] == '"');
+
+    if (quoted)
+    {
+        pos++;
+        while (pos < len)
+        {
+            const int start = pos;
+            while (pos < len && data[pos] != '"')
+                pos++;
+            field.append(data + start, pos - start);
+
+            if (pos >= len)
+                break;
+
+            // Either the closing quote, or the first half of an escaped one
+            pos++;
+            if (pos < len && data[pos] == '"')
+            {
+                field.append('"');
+                pos++;
+                continue;
+            }
+            break;
+        }
+    }
+
+    // Anything after a closing quote is ignored
+    const int start = pos;
+    while (pos < len && data[pos] != ',' && data[pos] != '\n' && data[pos] != '\r')
+        pos++;
+    if (!quoted)
+        field.append(data + start, pos - start);
+
+    line_end = (pos >= len || data[pos] != ',');
+    if (pos < len)
+    {
+        if (data[pos] == '\r' && pos + 1 < len && data[pos + 1] == '\n')
+            pos++;
+        pos++;
+    }
+}
+
+static bool set_number(DatFile &dat, const int row, const int col, const QByteArray &field)
+{
+    const DatColumn &column = dat.columns.at(col);
+    const int bits = column.size * 8;
+    bool ok = false;
+
+    switch (column.type)
+    {
+    case DAT_TYPE_U8:
+    case DAT_TYPE_U16:
+    case DAT_TYPE_U32:
+    case DAT_TYPE_U64:
+    {
+        const quint64 value = field.toULongLong(&ok);
+        ok = ok && (bits == 64 || value < (Q_UINT64_C(1) << bits));
+        if (ok)
+            dat_set_value(dat, row, col, value);
+        break;
+    }
+    case DAT_TYPE_S8:
+    case DAT_TYPE_S16:
+    case DAT_TYPE_S32:
+    case DAT_TYPE_S64:
+    {
+        const qint64 value = field.toLongLong(&ok);
+        ok = ok && (bits == 64 || (value >= -(Q_INT64_C(1) << (bits - 1)) && value < (Q_INT64_C(1) << (bits - 1))));
+        if (ok)
+            dat_set_value(dat, row, col, value);
+        break;
+    }
+    case DAT_TYPE_F32:
+    {
+        const float value = field.toFloat(&ok);
+        if (ok)
+            dat_set_value(dat, row, col, value);
+        break;
+    }
+    case DAT_TYPE_F64:
+    {
+        const double value = field.toDouble(&ok);
+        if (ok)
+            dat_set_value(dat, row, col, value);
+        break;
+    }
+    default:
+        break;
+    }
+
+    return ok;
+}
+
+static bool is_string_type(const DatType type)
+{
+    return type == DAT_TYPE_LABEL || type == DAT_TYPE_ASCII || type == DAT_TYPE_REFER || type == DAT_TYPE_UTF16;
+}
+
+enum CsvSection
+{
+    CSV_SECTION_NONE,
+    CSV_SECTION_LABELS,
+    CSV_SECTION_REFS
+};
+
+// Which table a "#LABELS" or "#REFS" line starting at "pos" begins, if any.
+static CsvSection section_at(const char *data, const int len, const int pos)
+{
+    for (const QByteArray &name : {QByteArray("#LABELS"), QByteArray("#REFS")})
+    {
+        const int end = pos + name.size();
+        if (end <= len && std::equal(name.constData(), name.constData() + name.size(), data + pos) &&
+                (end == len || data[end] == ',' || data[end] == '\n' || data[end] == '\r'))
+            return (name == "#LABELS") ? CSV_SECTION_LABELS : CSV_SECTION_REFS;
+    }
+    return CSV_SECTION_NONE;
+}
+
+// "#index" cells, with up to 5 ASCII digits.
+static bool parse_index_cell(const QByteArray &field, ushort &index)
+{
+    if (field.size() < 2 || field.size() > 6 || field.at(0) != '#')
+        return false;
+
+    uint value = 0;
+    for (int i = 1; i < field.size(); ++i)
+    {
+        if (field.at(i) < '0' || field.at(i) > '9')
+            return false;
+        value = (value * 10) + (field.at(i) - '0');
+    }
+
+    if (value > 0xFFFF)
+        return false;
+    index = value;
+    return true;
+}
+
+struct CsvStringCell
+{
+    int row;
+    int col;
+    int line;
+    QByteArray text;
+};
+
+bool dat_from_csv(const QByteArray &csv, DatFile &dat, QString &error)
+{
+    const char *data = csv.constData();
+    const int len = csv.size();
+    int pos = 0;
+    int line = 1;
+
+    dat = DatFile();
+
+    // Spreadsheets like to add a UTF-8 byte order mark
+    if (csv.startsWith("\xEF\xBB\xBF"))
+        pos = 3;
+
+    QByteArray field;
+    bool quoted = false;
+    bool line_end = false;
+
+    // Header
+    while (!line_end && pos < len)
+    {
+        read_field(data, len, pos, field, quoted, line_end);
+
+        // Older exports put a comma after every value
+        const QString header = QString::fromUtf8(field).trimmed();
+        if (header.isEmpty())
+            continue;
+
+        const int split = header.lastIndexOf(' ');
+        if (split <= 0)
+        {
+            error = "Invalid column header \"" + header + "\", expected \"name type\".";
+            return false;
+        }
+        dat.data_names.append(header.left(split));
+        dat.data_types.append(header.mid(split + 1));
+    }
+
+    if (dat.data_types.isEmpty())
+    {
+        error = "No column headers found.";
+        return false;
+    }
+    dat_build_columns(dat);
+
+    const int col_count = dat.columns.count();
+
+    // The string tables come after the rows, so string cells are resolved at the end
+    QVector<CsvStringCell> string_cells;
+    CsvSection section = CSV_SECTION_NONE;
+
+    int row = 0;
+    while (pos < len)
+    {
+        line++;
+
+        // Skip blank lines
+        if (data[pos] == '\n' || data[pos] == '\r')
+        {
+            if (data[pos] == '\r' && pos + 1 < len && data[pos + 1] == '\n')
+                pos++;
+            pos++;
+            continue;
+        }
+
+        const CsvSection new_section = section_at(data, len, pos);
+        if (new_section != CSV_SECTION_NONE)
+        {
+            section = new_section;
+            QStringList &strings = (section == CSV_SECTION_REFS) ? dat.refs : dat.labels;
+            strings.clear();
+
+            // Skip the rest of the line
+            line_end = false;
+            while (!line_end)
+                read_field(data, len, pos, field, quoted, line_end);
+            continue;
+        }
+
+        if (section != CSV_SECTION_NONE)
+        {
+            // An "index,text" row
+            QStringList &strings = (section == CSV_SECTION_REFS) ? dat.refs : dat.labels;
+
+            read_field(data, len, pos, field, quoted, line_end);
+            bool ok = false;
+            const int index = field.toInt(&ok);
+            if (!ok || index != strings.count())
+            {
+                error = "Expected string " + QString::number(strings.count()) + " on line " + QString::number(line) + ".";
+                return false;
+            }
+            if (strings.count() >= 0xFFFF)
+            {
+                error = "Too many strings on line " + QString::number(line) + ".";
+                return false;
+            }
+
+            QString str;
+            if (!line_end)
+            {
+                read_field(data, len, pos, field, quoted, line_end);
+                str = QString::fromUtf8(field);
+            }
+            strings.append(str);
+
+            // Spreadsheets may pad every row out to the same number of columns
+            while (!line_end)
+                read_field(data, len, pos, field, quoted, line_end);
+            continue;
+        }
+
+        const int old_size = dat.data.size();
+        dat.data.resize(old_size + dat.struct_size);
+        std::fill(dat.data.data() + old_size, dat.data.data() + dat.data.size(), 0x00);
+
+        int col = 0;
+        line_end = false;
+        while (!line_end)
+        {
+            read_field(data, len, pos, field, quoted, line_end);
+
+            if (col >= col_count)
+            {
+                if (field.isEmpty() && line_end)
+                    break;
+
+                error = "Too many values on line " + QString::number(line) + ", expected " + QString::number(col_count) + ".";
+                return false;
+            }
+
+            // Strings are text whether they're quoted or not, since spreadsheets drop the quotes
+            const DatType type = dat.columns.at(col).type;
+            if (is_string_type(type))
+            {
+                string_cells.append({row, col, line, field});
+            }
+            else if (type != DAT_TYPE_UNKNOWN && !set_number(dat, row, col, field))
+            {
+                error = "Expected a number at line " + QString::number(line) + ", item " + QString::number(col) + ", but got \"" + QString::fromUtf8(field) + "\".";
+                return false;
+            }
+
+            col++;
+        }
+
+        if (col < col_count)
+        {
+            error = "Not enough values on line " + QString::number(line) + ", expected " + QString::number(col_count) + ".";
+            return false;
+        }
+
+        row++;
+    }
+
+    QHash<QString, int> label_indexes = first_indexes(dat.labels);
+    QHash<QString, int> ref_indexes = first_indexes(dat.refs);
+    for (const CsvStringCell &cell : string_cells)
+    {
+        ushort index;
+        if (!parse_index_cell(cell.text, index))
+        {
+            const bool is_ref = (dat.columns.at(cell.col).type == DAT_TYPE_UTF16);
+            QStringList &strings = is_ref ? dat.refs : dat.labels;
+            QHash<QString, int> &indexes = is_ref ? ref_indexes : label_indexes;
+
+            const QString str = QString::fromUtf8(cell.text);
+            QHash<QString, int>::const_iterator it = indexes.constFind(str);
+            if (it != indexes.constEnd())
+            {
+                index = it.value();
+            }
+            else
+            {
+                if (strings.count() >= 0xFFFF)
+                {
+                    error = "Too many unique strings on line " + QString::number(cell.line) + ".";
+                    return false;
+                }
+                index = strings.count();
+                indexes.insert(str, index);
+                strings.append(str);
+            }
+        }
+        dat_set_value(dat, cell.row, cell.col, index);
+    }
+
+    return true;
+}
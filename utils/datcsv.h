@@ -0,0 +1,19 @@
+#ifndef DATCSV_H
+#define DATCSV_H
+
+#include "utils_global.h"
+#include "dat.h"
+
+// The first row holds a "name type" header for each column, followed by one row per struct.
+// String cells hold the text they point to, or "#index" if the index is out of range,
+// isn't the first copy of a duplicated string, or the text itself starts with '#'.
+// The label and ref tables follow in full, under "#LABELS" and "#REFS" lines,
+// as "index,text" rows in their original order, so unused and duplicate strings survive.
+UTILS_EXPORT QByteArray dat_to_csv(const DatFile &dat);
+// String cells are always read as text, quoted or not, and looked up in the tables.
+// Text that isn't in the tables is added to the end of them, and if the tables are
+// missing altogether, they're rebuilt from the string cells in order of first use.
+// Returns false and sets "error" if the CSV can't be converted.
+UTILS_EXPORT bool dat_from_csv(const QByteArray &csv, DatFile &dat, QString &error);
+
+#endif // DATCSV_H
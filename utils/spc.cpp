@@ -1,4 +1,15 @@
 #include "spc.h"
+#include "stats.h"
+#include <QCache>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+
+// Cache costs are measured in KB, so large budgets still fit in an int
+static QCache<QString, QByteArray> subfile_cache(256 * 1024);
+static QMutex subfile_cache_mutex;
+static int cache_hits = 0;
 
 SpcFile spc_from_bytes(const QByteArray &bytes)
 {
@@ -11,6 +22,8 @@ SpcFile spc_from_bytes(const QByteArray &bytes)
         return spc_from_bytes(srd_dec(bytes));
     }
 
+    StatsScope stats("spc_parse", bytes.size());
+
     if (magic != SPC_MAGIC)
     {
         cout << "Error: Invalid SPC file.\n";
@@ -52,6 +65,7 @@ SpcFile spc_from_bytes(const QByteArray &bytes)
         // We don't want the null terminator byte, so pretend it's padding
         pos += name_padding + 1;
 
+        subfile.offset = pos;
         subfile.data = get_bytes(bytes, pos, subfile.cmp_size);
         pos += data_padding;
 
@@ -97,10 +111,104 @@ QByteArray spc_to_bytes(const SpcFile &spc)
     return result;
 }
 
+QByteArray spc_subfile_data(const SpcSubfile &subfile, const QString &spc_filepath)
+{
+    switch (subfile.cmp_flag)
+    {
+    case 0x01:  // Uncompressed, don't do anything
+        return subfile.data;
+
+    case 0x02:  // Compressed
+        return spc_dec(subfile.data, subfile.dec_size);
+
+    case 0x03:  // Load from external file
+    {
+        QFile ext_file(spc_filepath + "_" + subfile.filename);
+        if (!ext_file.open(QFile::ReadOnly))
+            return QByteArray();
+        const QByteArray ext_data = ext_file.readAll();
+        ext_file.close();
+        return srd_dec(ext_data);
+    }
+    }
+
+    return QByteArray();
+}
+
+// Identifies where a subfile was read from, so a changed archive never serves stale data.
+// Archives inside other archives use the real file on disk that contains them.
+static QString file_stamp(const QString &path)
+{
+    QFileInfo info(path);
+    QString real_path = path;
+    while (!info.exists() && real_path.contains('/'))
+    {
+        real_path = real_path.left(real_path.lastIndexOf('/'));
+        info.setFile(real_path);
+    }
+
+    return QString::number(info.lastModified().toMSecsSinceEpoch()) + '|' + QString::number(info.size());
+}
+
+static QString subfile_cache_key(const SpcSubfile &subfile, const QString &spc_filepath)
+{
+    QString key = spc_filepath + '|' + file_stamp(spc_filepath) + '|' + QString::number(subfile.offset) + '|' + QString::number(subfile.cmp_flag);
+
+    if (subfile.cmp_flag == 0x03)
+        key += '|' + file_stamp(spc_filepath + "_" + subfile.filename);
+
+    return key;
+}
+
+QByteArray spc_subfile_data_cached(const SpcSubfile &subfile, const QString &spc_filepath)
+{
+    // Uncompressed data doesn't need any work, so don't waste cache space on it,
+    // and data that's been changed in memory has nothing on disk to identify it by.
+    if (subfile.cmp_flag == 0x01 || subfile.offset < 0)
+        return spc_subfile_data(subfile, spc_filepath);
+
+    const QString key = subfile_cache_key(subfile, spc_filepath);
+    {
+        QMutexLocker locker(&subfile_cache_mutex);
+        const QByteArray *cached = subfile_cache.object(key);
+        if (cached != nullptr)
+        {
+            cache_hits++;
+            return *cached;
+        }
+    }
+
+    // Decompress without holding the lock, so other threads aren't held up
+    const QByteArray result = spc_subfile_data(subfile, spc_filepath);
+
+    QMutexLocker locker(&subfile_cache_mutex);
+    subfile_cache.insert(key, new QByteArray(result), std::max(result.size() / 1024, 1));
+    return result;
+}
+
+void spc_set_cache_budget(const int megabytes)
+{
+    QMutexLocker locker(&subfile_cache_mutex);
+    subfile_cache.setMaxCost(megabytes * 1024);
+}
+
+void spc_clear_cache()
+{
+    QMutexLocker locker(&subfile_cache_mutex);
+    subfile_cache.clear();
+}
+
+int spc_cache_hits()
+{
+    QMutexLocker locker(&subfile_cache_mutex);
+    return cache_hits;
+}
+
 // This is the compression scheme used for
 // individual files in an spc archive
 QByteArray spc_dec(const QByteArray &bytes, int dec_size)
 {
+    StatsScope stats("spc_dec", bytes.size());
     const int cmp_size = bytes.size();
 
     if (dec_size <= 0)
@@ -140,6 +248,11 @@ QByteArray spc_dec(const QByteArray &bytes, int dec_size)
             const char count = (b >> 10) + 2;
             const short offset = b & 1023;
 
+            // A valid stream never points before the start of the data,
+            // so stop here rather than reading out of bounds.
+            if (result.size() - 1024 + offset < 0)
+                break;
+
             for (int i = 0; i < count; ++i)
             {
                 const int reverse_index = result.size() - 1024 + offset;
@@ -150,6 +263,7 @@ QByteArray spc_dec(const QByteArray &bytes, int dec_size)
         flag >>= 1;
     }
 
+    stats.set_bytes_out(result.size());
     return result;
 }
 
@@ -163,6 +277,7 @@ QByteArray spc_dec(const QByteArray &bytes, int dec_size)
 // a non-duplicate byte or reach the end of the readahead area.
 QByteArray spc_cmp(const QByteArray &dec_data)
 {
+    StatsScope stats("spc_cmp", dec_data.size());
     const int dec_size = dec_data.size();
 
     QByteArray cmp_data;
@@ -258,6 +373,7 @@ QByteArray spc_cmp(const QByteArray &dec_data)
         pos += l;
     }
 
+    stats.set_bytes_out(cmp_data.size());
     return cmp_data;
 }
 
@@ -414,6 +530,7 @@ QByteArray spc_cmp_old(const QByteArray &dec_data)
 
 QByteArray srd_dec(const QByteArray &bytes)
 {
+    StatsScope stats("srd_dec", bytes.size());
     int pos = 0;
     QByteArray result;
 
@@ -431,7 +548,8 @@ QByteArray srd_dec(const QByteArray &bytes)
     pos += 4;
     const int unk = num_from_bytes<uint>(bytes, pos, true);
 
-    result.reserve(dec_size);
+    // Don't trust the header with huge allocations, each compressed byte expands to 64 at most
+    result.reserve((int)std::min<qint64>(std::max(dec_size, 0), (qint64)bytes.size() * 64));
 
     while (true)
     {
@@ -469,6 +587,7 @@ QByteArray srd_dec(const QByteArray &bytes)
         throw "srd_dec size mismatch error";
     }
 
+    stats.set_bytes_out(result.size());
     return result;
 }
 
@@ -477,7 +596,7 @@ QByteArray srd_dec_chunk(const QByteArray &chunk, QString cmp_mode)
     const int chunk_size = chunk.size();
     int pos = 0;
     QByteArray result;
-    uint shift = -1;
+    int shift;
 
     if (cmp_mode == "$CLN")
         shift = 8;
@@ -485,18 +604,28 @@ QByteArray srd_dec_chunk(const QByteArray &chunk, QString cmp_mode)
         shift = 7;
     else if (cmp_mode == "$CL2")
         shift = 6;
+    else
+        return result;
 
     const int mask = (1 << shift) - 1;
 
     while (pos < chunk_size)
     {
-        const char b = chunk.at(pos++);
+        // These have to be read unsigned, otherwise anything >= 0x80 gets sign-extended
+        const uchar b = chunk.at(pos++);
 
         if (b & 1)
         {
             // Pull from the buffer
+            if (pos >= chunk_size)
+                break;
+
             const int count = (b & mask) >> 1;
-            const int offset = ((b >> shift) << 8) | chunk.at(pos++);
+            const int offset = ((b >> shift) << 8) | (uchar)chunk.at(pos++);
+
+            // Stop at anything pointing outside the data we have so far
+            if (offset <= 0 || offset > result.size())
+                break;
 
             for (int i = 0; i < count; ++i)
             {
@@ -16,6 +16,7 @@ struct UTILS_EXPORT SpcSubfile
     int cmp_size;
     int dec_size;
     int name_len;
+    int offset = -1;    // Where "data" starts in the archive, or -1 if it wasn't read from one (or has changed since)
 };
 
 struct UTILS_EXPORT SpcFile
@@ -28,6 +29,19 @@ struct UTILS_EXPORT SpcFile
 
 UTILS_EXPORT SpcFile spc_from_bytes(const QByteArray &bytes);
 UTILS_EXPORT QByteArray spc_to_bytes(const SpcFile &spc);
+// Returns the decompressed contents of "subfile". Subfiles stored in an external file
+// (cmp_flag 0x03) are loaded from "<spc_filepath>_<subfile name>".
+UTILS_EXPORT QByteArray spc_subfile_data(const SpcSubfile &subfile, const QString &spc_filepath);
+// Same as spc_subfile_data(), but recently used results are kept in a shared cache,
+// so touching the same subfile again doesn't decompress (or re-read) it again.
+// Entries are keyed on the archive's path, modification time and size, and the subfile's offset,
+// so subfiles which weren't read straight from an archive on disk (offset -1) are never cached.
+// The least recently used entries are dropped once the cache exceeds its budget.
+UTILS_EXPORT QByteArray spc_subfile_data_cached(const SpcSubfile &subfile, const QString &spc_filepath);
+UTILS_EXPORT void spc_set_cache_budget(const int megabytes);
+UTILS_EXPORT void spc_clear_cache();
+// Number of spc_subfile_data_cached() calls answered from the cache so far.
+UTILS_EXPORT int spc_cache_hits();
 UTILS_EXPORT QByteArray spc_dec(const QByteArray &bytes, int dec_size = -1);
 UTILS_EXPORT QByteArray spc_cmp(const QByteArray &bytes);
 UTILS_EXPORT QByteArray srd_dec(const QByteArray &bytes);
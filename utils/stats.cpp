@@ -0,0 +1,206 @@
+#include "stats.h"
+#include <atomic>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QThread>
+
+struct StatsEvent
+{
+    int stage;
+    quintptr thread;
+    qint64 start;
+    qint64 nsecs;
+};
+
+static std::atomic<bool> enabled(false);
+static bool tracing = false;
+static QElapsedTimer stats_clock;
+static QMutex stats_mutex;
+static QHash<QByteArray, int> stage_indexes;
+static QVector<StatsStage> stages;
+static QVector<StatsEvent> events;
+
+void stats_enable(const bool trace)
+{
+    QMutexLocker locker(&stats_mutex);
+    tracing = trace;
+    stats_clock.start();
+    enabled = true;
+}
+
+void stats_disable()
+{
+    QMutexLocker locker(&stats_mutex);
+    enabled = false;
+    tracing = false;
+}
+
+bool stats_enabled()
+{
+    return enabled;
+}
+
+void stats_reset()
+{
+    QMutexLocker locker(&stats_mutex);
+    stage_indexes.clear();
+    stages.clear();
+    events.clear();
+}
+
+QVector<StatsStage> stats_stages()
+{
+    QMutexLocker locker(&stats_mutex);
+    return stages;
+}
+
+static QString format_bytes(const qint64 bytes)
+{
+    if (bytes >= 1024 * 1024)
+        return QString::number(bytes / (1024.0 * 1024.0), 'f', 1) + " MB";
+    if (bytes >= 1024)
+        return QString::number(bytes / 1024.0, 'f', 1) + " KB";
+    return QString::number(bytes) + " B";
+}
+
+QString stats_report()
+{
+    const QVector<StatsStage> all_stages = stats_stages();
+
+    QString result;
+    result += QString("%1 %2 %3 %4 %5 %6\n")
+            .arg("Stage", -16).arg("Calls", 8).arg("Total ms", 11).arg("Avg us", 10).arg("In", 10).arg("Out", 10);
+
+    for (const StatsStage &stage : all_stages)
+    {
+        result += QString("%1 %2 %3 %4 %5 %6\n")
+                .arg(QString::fromUtf8(stage.name), -16)
+                .arg(stage.calls, 8)
+                .arg(stage.nsecs / 1e6, 11, 'f', 2)
+                .arg(stage.calls > 0 ? stage.nsecs / 1e3 / stage.calls : 0.0, 10, 'f', 1)
+                .arg(stage.bytes_in > 0 ? format_bytes(stage.bytes_in) : QString("-"), 10)
+                .arg(stage.bytes_out > 0 ? format_bytes(stage.bytes_out) : QString("-"), 10);
+    }
+
+    return result;
+}
+
+QByteArray stats_to_json()
+{
+    const QVector<StatsStage> all_stages = stats_stages();
+
+    QJsonArray stage_array;
+    for (const StatsStage &stage : all_stages)
+    {
+        QJsonObject obj;
+        obj["name"] = QString::fromUtf8(stage.name);
+        obj["calls"] = stage.calls;
+        obj["nsecs"] = stage.nsecs;
+        obj["bytes_in"] = stage.bytes_in;
+        obj["bytes_out"] = stage.bytes_out;
+        stage_array.append(obj);
+    }
+
+    QJsonObject root;
+    root["stages"] = stage_array;
+    return QJsonDocument(root).toJson();
+}
+
+QByteArray stats_to_chrome_trace()
+{
+    QMutexLocker locker(&stats_mutex);
+
+    // Chrome wants small thread IDs, and timestamps in microseconds
+    QHash<quintptr, int> thread_ids;
+    QJsonArray trace_events;
+    for (const StatsEvent &event : events)
+    {
+        if (!thread_ids.contains(event.thread))
+            thread_ids.insert(event.thread, thread_ids.count() + 1);
+
+        QJsonObject obj;
+        obj["name"] = QString::fromUtf8(stages.at(event.stage).name);
+        obj["ph"] = QString("X");
+        obj["pid"] = 1;
+        obj["tid"] = thread_ids.value(event.thread);
+        obj["ts"] = event.start / 1e3;
+        obj["dur"] = event.nsecs / 1e3;
+        trace_events.append(obj);
+    }
+
+    QJsonObject root;
+    root["traceEvents"] = trace_events;
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+static void save_file(const QString &filepath, const QByteArray &data)
+{
+    QFile f(filepath);
+    if (!f.open(QFile::WriteOnly))
+    {
+        cout << "Error: Failed to create \"" << filepath << "\".\n";
+        cout.flush();
+        return;
+    }
+    f.write(data);
+    f.close();
+}
+
+void stats_write(const bool print, const QString &json_path, const QString &trace_path)
+{
+    if (print)
+    {
+        cout << "\n" << stats_report();
+        cout.flush();
+    }
+
+    if (!json_path.isEmpty())
+        save_file(json_path, stats_to_json());
+    if (!trace_path.isEmpty())
+        save_file(trace_path, stats_to_chrome_trace());
+}
+
+StatsScope::StatsScope(const char *stage, const qint64 bytes_in) : stage(stage), bytes_in(bytes_in)
+{
+    if (enabled)
+        start = stats_clock.nsecsElapsed();
+}
+
+StatsScope::~StatsScope()
+{
+    if (start < 0)
+        return;
+
+    const qint64 end = stats_clock.nsecsElapsed();
+
+    QMutexLocker locker(&stats_mutex);
+    const QByteArray name(stage);
+    int index = stage_indexes.value(name, -1);
+    if (index < 0)
+    {
+        index = stages.count();
+        StatsStage new_stage;
+        new_stage.name = name;
+        stages.append(new_stage);
+        stage_indexes.insert(name, index);
+    }
+
+    StatsStage &s = stages[index];
+    s.calls++;
+    s.nsecs += end - start;
+    s.bytes_in += bytes_in;
+    s.bytes_out += bytes_out;
+
+    if (tracing)
+        events.append({index, (quintptr)QThread::currentThreadId(), start, end - start});
+}
+
+void StatsScope::set_bytes_out(const qint64 bytes)
+{
+    bytes_out = bytes;
+}
@@ -0,0 +1,58 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include "utils_global.h"
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+// Lightweight per-stage timing, for finding out where the command line tools spend their time.
+// Wrap a stage in a StatsScope to count the call, how long it took, and (optionally) the bytes in and out:
+//
+//     StatsScope scope("spc_dec", bytes.size());
+//     ...
+//     scope.set_bytes_out(result.size());
+//
+// Nothing is recorded (and a scope costs next to nothing) until stats_enable() is called.
+// Stages may nest, in which case the outer stage's time includes the inner one's.
+struct UTILS_EXPORT StatsStage
+{
+    QByteArray name;
+    qint64 calls = 0;
+    qint64 nsecs = 0;
+    qint64 bytes_in = 0;
+    qint64 bytes_out = 0;
+};
+
+// If "trace" is true, every call is also kept, for stats_to_chrome_trace().
+UTILS_EXPORT void stats_enable(const bool trace = false);
+// Stops recording. Anything recorded so far is kept until stats_reset().
+UTILS_EXPORT void stats_disable();
+UTILS_EXPORT bool stats_enabled();
+// Forgets every stage and traced call recorded so far.
+UTILS_EXPORT void stats_reset();
+// Stages in the order they were first used.
+UTILS_EXPORT QVector<StatsStage> stats_stages();
+UTILS_EXPORT QString stats_report();
+UTILS_EXPORT QByteArray stats_to_json();
+// Loads in chrome://tracing or https://ui.perfetto.dev
+UTILS_EXPORT QByteArray stats_to_chrome_trace();
+// For the command line tools' "--stats", "--stats-json <file>" and "--stats-trace <file>" options.
+// Prints the report if "print" is true, and saves the JSON/trace to any non-empty paths.
+UTILS_EXPORT void stats_write(const bool print, const QString &json_path, const QString &trace_path);
+
+class UTILS_EXPORT StatsScope
+{
+public:
+    explicit StatsScope(const char *stage, const qint64 bytes_in = 0);
+    ~StatsScope();
+    void set_bytes_out(const qint64 bytes);
+
+private:
+    const char *stage;
+    qint64 bytes_in;
+    qint64 bytes_out = 0;
+    qint64 start = -1;
+};
+
+#endif // STATS_H
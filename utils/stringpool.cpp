@@ -0,0 +1,46 @@
+#include "stringpool.h"
+
+StrHandle StringPool::intern(const QString &str)
+{
+    {
+        QReadLocker locker(&lock);
+        const QHash<QString, StrHandle>::const_iterator it = handles.constFind(str);
+        if (it != handles.constEnd())
+            return it.value();
+    }
+
+    QWriteLocker locker(&lock);
+
+    // Someone else may have added it while we were waiting for the lock
+    const QHash<QString, StrHandle>::const_iterator it = handles.constFind(str);
+    if (it != handles.constEnd())
+        return it.value();
+
+    const StrHandle handle = strings.count();
+    strings.append(str);
+    handles.insert(str, handle);
+    return handle;
+}
+
+bool StringPool::find(const QString &str, StrHandle &handle) const
+{
+    QReadLocker locker(&lock);
+    const QHash<QString, StrHandle>::const_iterator it = handles.constFind(str);
+    if (it == handles.constEnd())
+        return false;
+
+    handle = it.value();
+    return true;
+}
+
+QString StringPool::at(const StrHandle handle) const
+{
+    QReadLocker locker(&lock);
+    return strings.at(handle);
+}
+
+int StringPool::count() const
+{
+    QReadLocker locker(&lock);
+    return strings.count();
+}
@@ -0,0 +1,34 @@
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+
+#include "utils_global.h"
+#include <QHash>
+#include <QReadWriteLock>
+#include <QString>
+#include <QVector>
+
+// A handle to a string stored in a StringPool. Two strings in the
+// same pool are equal if (and only if) their handles are equal.
+typedef uint StrHandle;
+
+// A thread-safe pool of unique strings. Strings that repeat across many files
+// (such as WRD params and label names) only need to be stored once, and every
+// copy returned by at() shares the same data.
+// Handles stay valid for as long as the pool does. There's no global pool: whatever
+// loads the strings (like a WrdCorpus) owns one, and it's freed along with it.
+class UTILS_EXPORT StringPool
+{
+public:
+    StrHandle intern(const QString &str);
+    // Returns false if "str" isn't in the pool, without adding it.
+    bool find(const QString &str, StrHandle &handle) const;
+    QString at(const StrHandle handle) const;
+    int count() const;
+
+private:
+    mutable QReadWriteLock lock;
+    QHash<QString, StrHandle> handles;
+    QVector<QString> strings;
+};
+
+#endif // STRINGPOOL_H
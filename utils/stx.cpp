@@ -1,96 +1,372 @@
 #include "stx.h"
+#include "stats.h"
 
+#include <QHash>
 #include <QTextCodec>
+#include <QtEndian>
 
-QStringList get_stx_strings(const QByteArray &bytes)
+// If "views" is true, the strings point directly into
+// "bytes" instead of holding their own copy of the text.
+static bool read_stx(const QByteArray &bytes, const bool views, StxFile &result, QString &error)
 {
+    StatsScope stats("stx_parse", bytes.size());
+    result = StxFile();
     int pos = 0;
-    QStringList strings;
 
-    QString magic = str_from_bytes(bytes, pos, 4);
+    const QString magic = str_from_bytes(bytes, pos, 4);
     if (magic != STX_MAGIC)
     {
-        //cout << "Invalid STX file.\n";
-        return strings;
+        error = "Invalid STX file.";
+        return false;
     }
 
-    QString lang = str_from_bytes(bytes, pos, 4);      // "JPLL" in the JP and US versions
-    const uint unk1 = num_from_bytes<uint>(bytes, pos); // Table count?
-    const uint table_off  = num_from_bytes<uint>(bytes, pos);
-    const uint unk2 = num_from_bytes<uint>(bytes, pos);
-    const uint table_len = num_from_bytes<uint>(bytes, pos);
+    result.lang = str_from_bytes(bytes, pos, 4);
+    const uint table_count = num_from_bytes<uint>(bytes, pos);
+    const uint table_off = num_from_bytes<uint>(bytes, pos);
+
+    if (table_count != 1)
+    {
+        error = "Unsupported STX file with " + QString::number(table_count) + " tables.";
+        return false;
+    }
 
-    for (uint i = 0; i < table_len; ++i)
+    // The table's (unk, table_len) pair follows the header at 0x10,
+    // and its entries start at table_off.
+    const char *data = bytes.constData();
+    const uint entry_off = table_off;
+    if (bytes.size() >= 0x18 && entry_off <= (uint)bytes.size())
     {
-        pos = table_off + (8 * i);
-        const uint str_id = num_from_bytes<uint>(bytes, pos);
-        const uint str_off = num_from_bytes<uint>(bytes, pos);
+        StxTable table;
+        table.unk = num_from_bytes<uint>(bytes, pos);
+        uint table_len = num_from_bytes<uint>(bytes, pos);
+
+        // Don't trust the table to fit inside the file
+        table_len = std::min(table_len, (bytes.size() - entry_off) / 8);
+
+        // Read the table sequentially, and only jump out to the string data itself
+        table.ids.reserve(table_len);
+        table.strings.reserve(table_len);
+        for (uint i = 0; i < table_len; ++i)
+        {
+            const uchar *entry = reinterpret_cast<const uchar*>(data + entry_off + (8 * i));
+            const uint str_id = qFromLittleEndian<quint32>(entry);
+            const uint str_off = qFromLittleEndian<quint32>(entry + 4);
 
-        pos = str_off;
+            table.ids.append(str_id);
 
-        QString str = str_from_bytes(bytes, pos, -1, "UTF16LE");
-        strings.append(str);
+            if (str_off >= (uint)bytes.size())
+            {
+                table.strings.append(QString());
+                continue;
+            }
+
+            const QChar *str_data = reinterpret_cast<const QChar*>(data + str_off);
+            const int str_len = utf16_len(data + str_off, (bytes.size() - str_off) / 2);
+
+            // QChar needs to be 2-byte aligned, so fall back to copying if it isn't
+            if (views && (str_off % 2) == 0)
+                table.strings.append(QString::fromRawData(str_data, str_len));
+            else
+                table.strings.append(QString(str_data, str_len));
+        }
+
+        result.tables.append(table);
+    }
+    else
+    {
+        result.tables.append(StxTable());
     }
 
-    return strings;
+    return true;
 }
 
-QByteArray repack_stx_strings(QStringList strings)
+StxFile stx_from_bytes(const QByteArray &bytes)
 {
-    QByteArray result;
-    uint table_off = 0x20;
-    int table_len = strings.count();
-
-    result.append(QString("STXTJPLL").toUtf8());    // header
-    result.append(num_to_bytes((uint)0x01));        // table_count?
-    result.append(num_to_bytes(table_off));         // table_off
-    result.append(num_to_bytes((uint)0x08));        // unk2
-    result.append(num_to_bytes(table_len));         // table_len
-
-    int *offsets = new int[table_len];
-    int highest_index = 0;
-    for (int i = 0; i < table_len; ++i)
+    StxFile result;
+    QString error;
+    if (!read_stx(bytes, false, result, error))
     {
-        result.append((table_off + (i * 8)) - (result.size()), (char)0x00); // padding
+        cout << "Error: " << error << "\n";
+        cout.flush();
+        throw 1;
+    }
+    return result;
+}
+
+bool stx_from_bytes(const QByteArray &bytes, StxFile &stx, QString &error)
+{
+    return read_stx(bytes, false, stx, error);
+}
+
+bool stx_from_bytes_view(const QByteArray &bytes, StxFile &stx, QString &error)
+{
+    return read_stx(bytes, true, stx, error);
+}
 
-        int str_off = 0;
-        for (int j = 0; j < i; j++)
+QByteArray stx_to_bytes(const StxFile &stx, const bool merge_tails)
+{
+    StatsScope stats("stx_write");
+
+    if (stx.tables.count() != 1)
+    {
+        cout << "Error: Can't write an STX file with " << stx.tables.count() << " tables.\n";
+        cout.flush();
+        throw 1;
+    }
+
+    // The table's descriptor follows the header, and its entries start at 0x20.
+    const StxTable &table = stx.tables.first();
+    const uint table_off = 0x20;
+    const QStringList &strings = table.strings;
+    const int table_len = strings.count();
+
+    // Only store each unique string once.
+    QHash<QString, int> unique_indexes;
+    QVector<int> string_unique;     // Which unique string each table entry uses
+    QStringList unique;
+    string_unique.reserve(table_len);
+    for (const QString &str : strings)
+    {
+        QHash<QString, int>::const_iterator it = unique_indexes.constFind(str);
+        if (it == unique_indexes.constEnd())
         {
-            if (strings[i] == strings[j])
+            it = unique_indexes.insert(str, unique.count());
+            unique.append(str);
+        }
+        string_unique.append(it.value());
+    }
+
+    // Each unique string is either written out in full (it's a "root"),
+    // or it's the tail end of a longer root string and can point into that instead.
+    QVector<int> roots(unique.count());
+    for (int u = 0; u < unique.count(); ++u)
+        roots[u] = u;
+
+    if (merge_tails)
+    {
+        // When sorted by their reversed text, a string which is the tail of any other
+        // string will also be the tail of the one directly after it.
+        QVector<int> order = roots;
+        std::sort(order.begin(), order.end(), [&unique](const int a, const int b) {
+            const QString &x = unique.at(a);
+            const QString &y = unique.at(b);
+            int i = x.size() - 1;
+            int j = y.size() - 1;
+            for (; i >= 0 && j >= 0; --i, --j)
             {
-                str_off = offsets[j];
+                if (x.at(i) != y.at(j))
+                    return x.at(i) < y.at(j);
             }
-        }
+            return i < j;
+        });
 
-        // If there are no previous occurences of this string or it's the first one
-        if (i == 0)
+        for (int k = order.count() - 2; k >= 0; --k)
         {
-            str_off = 0x20 + (8 * table_len);   // 8 bytes per table entry
-        }
-        else if (str_off == 0)
-        {
-            str_off = offsets[highest_index] + ((strings[highest_index].size() + 1) * 2);
-            highest_index = i;
+            if (unique.at(order.at(k + 1)).endsWith(unique.at(order.at(k))))
+                roots[order.at(k)] = roots.at(order.at(k + 1));
         }
+    }
 
-        offsets[i] = str_off;
+    // Lay out the root strings right after the table, in the order they first appear.
+    QVector<int> unique_offsets(unique.count());
+    int data_size = table_off + (8 * table_len);
+    for (int u = 0; u < unique.count(); ++u)
+    {
+        if (roots.at(u) != u)
+            continue;
 
-        result.append(num_to_bytes(i));         // str_index
-        result.append(num_to_bytes(str_off));   // str_off
+        unique_offsets[u] = data_size;
+        data_size += (unique.at(u).size() + 1) * 2;
+    }
+    for (int u = 0; u < unique.count(); ++u)
+    {
+        const int root = roots.at(u);
+        unique_offsets[u] = unique_offsets.at(root) + ((unique.at(root).size() - unique.at(u).size()) * 2);
     }
 
-    QStringList written;
+
+    QByteArray result(data_size, 0x00);
+    char *out = result.data();
+    int pos = 0;
+
+    QByteArray lang = (stx.lang.isEmpty() ? QString("JPLL") : stx.lang).toUtf8().left(4);
+    lang.append(4 - lang.size(), 0x00);
+    const QByteArray magic = STX_MAGIC.toUtf8() + lang;
+    std::copy(magic.begin(), magic.end(), out);     // header
+    pos += magic.size();
+    num_to_buf((uint)1, out, pos);                  // table_count
+    num_to_buf(table_off, out, pos);                // table_off
+    num_to_buf(table.unk, out, pos);                // unk
+    num_to_buf((uint)table_len, out, pos);          // table_len
+
+    pos = table_off;
     for (int i = 0; i < table_len; ++i)
     {
-        if (written.contains(strings[i]))
-            continue;
+        const uint str_id = (i < table.ids.count()) ? table.ids.at(i) : (uint)i;
+        num_to_buf(str_id, out, pos);                                       // str_id
+        num_to_buf(unique_offsets.at(string_unique.at(i)), out, pos);       // str_off
+    }
 
-        const QByteArray bytes = str_to_bytes(strings[i], true);
+    for (int u = 0; u < unique.count(); ++u)
+    {
+        if (roots.at(u) != u)
+            continue;
 
-        result.append(bytes);
-        written.append(strings[i]);
+        // Null terminator is already zeroed
+        const char *str_data = reinterpret_cast<const char*>(unique.at(u).utf16());
+        std::copy(str_data, str_data + (unique.at(u).size() * 2), out + unique_offsets.at(u));
     }
-    delete[] offsets;
 
+    stats.set_bytes_out(result.size());
     return result;
 }
+
+static QStringList read_stx_strings(const QByteArray &bytes, const bool views)
+{
+    StxFile stx;
+    QString error;
+    if (!read_stx(bytes, views, stx, error))
+        return QStringList();
+
+    return stx.tables.first().strings;
+}
+
+QStringList get_stx_strings(const QByteArray &bytes)
+{
+    return read_stx_strings(bytes, false);
+}
+
+QStringList get_stx_string_views(const QByteArray &bytes)
+{
+    return read_stx_strings(bytes, true);
+}
+
+QByteArray repack_stx_strings(QStringList strings, const bool merge_tails)
+{
+    StxTable table;
+    table.strings = strings;
+
+    StxFile stx;
+    stx.lang = "JPLL";
+    stx.tables.append(table);
+    return stx_to_bytes(stx, merge_tails);
+}
+
+QString stx_strings_to_text(const QStringList &strings)
+{
+    QString text;
+    for (int i = 0; i < strings.count(); i++)
+    {
+        text += "##### " + QString::number(i).rightJustified(4, '0') + "\n";
+        text += strings.at(i) + "\n\n";
+    }
+    return text;
+}
+
+// Copies text[start, end) into "strings" at "index", turning any Windows-style
+// or old Mac-style line breaks into '\n' on the way.
+static void store_text_string(QStringList &strings, const int index, const QString &text, const int start, const int end)
+{
+    while (strings.count() <= index)
+        strings.append(QString());
+
+    const QChar *in = text.constData();
+    QString str(end - start, Qt::Uninitialized);
+    QChar *out = str.data();
+    int len = 0;
+    for (int i = start; i < end; i++)
+    {
+        if (in[i] == '\r')
+        {
+            out[len++] = '\n';
+            if (i + 1 < end && in[i + 1] == '\n')
+                i++;
+        }
+        else
+        {
+            out[len++] = in[i];
+        }
+    }
+    str.truncate(len);
+    strings[index] = str;
+}
+
+bool stx_strings_from_text(const QString &text, QStringList &strings, QString &error)
+{
+    // The original files (usually) use Unix-style line breaks.
+    // A couple files sometimes have the occasional Windows-style line break,
+    // but since these are almost certainly not intentional, we sanitize them anyway.
+    // Each string is copied out of "text" exactly once, when its header ends it.
+    const QChar *data = text.constData();
+    const int len = text.size();
+
+    // Gaps between indexes are filled with empty strings, so don't let a
+    // stray huge number allocate far more strings than the text could hold.
+    const int max_digits = 7;
+    const int max_index = len;
+
+    strings.clear();
+    int index = -1;         // Index of the string currently being read, if any
+    int str_start = 0;
+    int str_end = 0;        // Trailing blank lines are only separators, so they aren't included
+
+    int pos = 0;
+    int line = 0;
+    while (pos < len)
+    {
+        line++;
+        const int line_start = pos;
+        while (pos < len && data[pos] != '\n' && data[pos] != '\r')
+            pos++;
+        const int line_end = pos;
+
+        if (pos < len)
+        {
+            if (data[pos] == '\r' && pos + 1 < len && data[pos + 1] == '\n')
+                pos++;
+            pos++;
+        }
+
+        if (line_end > line_start && data[line_start] == '#')
+        {
+            if (index >= 0)
+                store_text_string(strings, index, text, str_start, str_end);
+
+            // "##### NNNN", falling back to the next index if the number is missing
+            int num_pos = line_start;
+            while (num_pos < line_end && (data[num_pos] == '#' || data[num_pos] == ' '))
+                num_pos++;
+
+            int new_index = 0;
+            int digits = 0;
+            while (num_pos < line_end && data[num_pos] >= '0' && data[num_pos] <= '9')
+            {
+                if (++digits > max_digits)
+                    break;
+                new_index = (new_index * 10) + (data[num_pos].unicode() - '0');
+                num_pos++;
+            }
+            if (digits == 0)
+                new_index = index + 1;
+
+            if (digits > max_digits || new_index > max_index)
+            {
+                error = "String index on line " + QString::number(line) + " is too large.";
+                return false;
+            }
+            index = new_index;
+
+            str_start = pos;
+            str_end = pos;
+            continue;
+        }
+
+        if (line_end > line_start)
+            str_end = line_end;
+    }
+
+    if (index >= 0)
+        store_text_string(strings, index, text, str_start, str_end);
+
+    return true;
+}
@@ -6,7 +6,44 @@
 
 const QString STX_MAGIC = "STXT";
 
+struct UTILS_EXPORT StxTable
+{
+    uint unk = 8;               // Always 8 in the files we've seen
+    QVector<uint> ids;          // String ID for each string (defaults to its index if missing)
+    QStringList strings;
+};
+
+// Every file we've seen has a single table, which is the only layout we know for sure,
+// so files claiming any other number of tables are rejected rather than guessed at.
+struct UTILS_EXPORT StxFile
+{
+    QString filename;
+    QString lang;               // "JPLL" in the JP and US versions
+    QVector<StxTable> tables;   // Always exactly one
+};
+
+// Throws if the magic is wrong or the file doesn't have exactly one table.
+UTILS_EXPORT StxFile stx_from_bytes(const QByteArray &bytes);
+// Same as above, but returns false and sets "error" instead of printing it and throwing,
+// so it's safe to call from worker threads.
+UTILS_EXPORT bool stx_from_bytes(const QByteArray &bytes, StxFile &stx, QString &error);
+// Same as stx_from_bytes(), but without copying the text out of "bytes".
+// The strings are only valid as long as "bytes" is kept alive and unmodified.
+UTILS_EXPORT bool stx_from_bytes_view(const QByteArray &bytes, StxFile &stx, QString &error);
+// Identical strings are only stored once. If "merge_tails" is true, strings which
+// are the tail end of another string also point into that string's data.
+// Throws if "stx" doesn't have exactly one table.
+UTILS_EXPORT QByteArray stx_to_bytes(const StxFile &stx, const bool merge_tails = false);
+
+// Convenience functions for working with just the strings.
+// These return an empty list instead of throwing if the file isn't supported.
 UTILS_EXPORT QStringList get_stx_strings(const QByteArray &bytes);
-UTILS_EXPORT QByteArray repack_stx_strings(QStringList strings);
+UTILS_EXPORT QStringList get_stx_string_views(const QByteArray &bytes);
+UTILS_EXPORT QByteArray repack_stx_strings(QStringList strings, const bool merge_tails = false);
+
+// Plain-text format used by stx_ex, where each string is preceded by a "##### NNNN" line.
+UTILS_EXPORT QString stx_strings_to_text(const QStringList &strings);
+// Returns false and sets "error" if a string index is unreasonably large for the size of the text.
+UTILS_EXPORT bool stx_strings_from_text(const QString &text, QStringList &strings, QString &error);
 
 #endif // STX_H
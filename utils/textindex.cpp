@@ -0,0 +1,148 @@
+#include "textindex.h"
+#include <algorithm>
+
+static quint64 make_key(const int source, const int index)
+{
+    return ((quint64)(uint)source << 32) | (uint)index;
+}
+
+static QSet<quint64> trigrams(const QString &folded)
+{
+    QSet<quint64> result;
+    const ushort *chars = folded.utf16();
+    for (int i = 0; i + 3 <= folded.size(); ++i)
+        result.insert(((quint64)chars[i] << 32) | ((quint64)chars[i + 1] << 16) | chars[i + 2]);
+    return result;
+}
+
+void TextIndex::update_entry(const int source, const int index, const QString &text)
+{
+    QStringList &src_texts = texts[source];
+    QStringList &src_folded = folded_texts[source];
+    while (src_texts.count() <= index)
+    {
+        src_texts.append(QString());
+        src_folded.append(QString());
+    }
+
+    if (src_texts.at(index) == text)
+        return;
+
+    const quint64 key = make_key(source, index);
+    for (const quint64 gram : trigrams(src_folded.at(index)))
+    {
+        QHash<quint64, QSet<quint64>>::iterator it = postings.find(gram);
+        if (it == postings.end())
+            continue;
+
+        it.value().remove(key);
+        if (it.value().isEmpty())
+            postings.erase(it);
+    }
+
+    src_texts[index] = text;
+    src_folded[index] = text.toCaseFolded();
+    for (const quint64 gram : trigrams(src_folded.at(index)))
+        postings[gram].insert(key);
+}
+
+void TextIndex::set_texts(const int source, const QStringList &new_texts)
+{
+    QWriteLocker locker(&lock);
+
+    for (int i = 0; i < new_texts.count(); ++i)
+        update_entry(source, i, new_texts.at(i));
+
+    // Un-index anything past the new end of the list
+    const int old_count = texts.value(source).count();
+    for (int i = old_count - 1; i >= new_texts.count(); --i)
+        update_entry(source, i, QString());
+
+    QStringList &src_texts = texts[source];
+    QStringList &src_folded = folded_texts[source];
+    while (src_texts.count() > new_texts.count())
+    {
+        src_texts.removeLast();
+        src_folded.removeLast();
+    }
+}
+
+void TextIndex::set_text(const int source, const int index, const QString &text)
+{
+    QWriteLocker locker(&lock);
+    update_entry(source, index, text);
+}
+
+void TextIndex::remove_source(const int source)
+{
+    set_texts(source, QStringList());
+
+    QWriteLocker locker(&lock);
+    texts.remove(source);
+    folded_texts.remove(source);
+}
+
+QString TextIndex::text(const TextMatch &match) const
+{
+    QReadLocker locker(&lock);
+    return texts.value(match.source).value(match.index);
+}
+
+QVector<TextMatch> TextIndex::find(const QString &query, const int limit) const
+{
+    QReadLocker locker(&lock);
+
+    QVector<TextMatch> result;
+    const QString needle = query.toCaseFolded();
+    if (needle.isEmpty())
+        return result;
+
+    QVector<quint64> keys;
+    if (needle.size() < 3)
+    {
+        // Too short to have any trigrams, so just check every string
+        QList<int> sources = folded_texts.keys();
+        std::sort(sources.begin(), sources.end());
+        for (const int source : sources)
+        {
+            const QStringList &src_folded = folded_texts.constFind(source).value();
+            for (int i = 0; i < src_folded.count(); ++i)
+            {
+                if (src_folded.at(i).contains(needle))
+                    keys.append(make_key(source, i));
+            }
+        }
+    }
+    else
+    {
+        QVector<const QSet<quint64> *> sets;
+        for (const quint64 gram : trigrams(needle))
+        {
+            const QHash<quint64, QSet<quint64>>::const_iterator it = postings.constFind(gram);
+            if (it == postings.constEnd())
+                return result;
+            sets.append(&it.value());
+        }
+
+        // Walk the rarest trigram's strings, and keep the ones which contain every other trigram.
+        // Having all the trigrams doesn't mean they're in the right order, so check the actual text too.
+        std::sort(sets.begin(), sets.end(), [](const QSet<quint64> *a, const QSet<quint64> *b) { return a->size() < b->size(); });
+        for (const quint64 key : *sets.first())
+        {
+            bool found = true;
+            for (int s = 1; s < sets.count() && found; ++s)
+                found = sets.at(s)->contains(key);
+
+            if (found && folded_texts.constFind((int)(key >> 32)).value().at((int)(uint)key).contains(needle))
+                keys.append(key);
+        }
+        std::sort(keys.begin(), keys.end());
+    }
+
+    const int count = (limit < 0) ? keys.count() : qMin(limit, keys.count());
+    result.reserve(count);
+    for (int i = 0; i < count; ++i)
+        result.append({(int)(keys.at(i) >> 32), (int)(uint)keys.at(i)});
+
+    return result;
+}
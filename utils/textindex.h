@@ -0,0 +1,42 @@
+#ifndef TEXTINDEX_H
+#define TEXTINDEX_H
+
+#include "utils_global.h"
+#include <QHash>
+#include <QReadWriteLock>
+#include <QSet>
+#include <QStringList>
+#include <QVector>
+
+// Entry "index" of the list stored under "source" in a TextIndex.
+struct UTILS_EXPORT TextMatch
+{
+    int source;
+    int index;
+};
+
+// A thread-safe, case-insensitive substring index over lists of strings
+// (STX strings, WRD params/strings, DAT labels/refs, etc). Each string is split into
+// trigrams, so a search only has to check the strings containing every trigram
+// of the query, instead of scanning all of them.
+// Updating a source only re-indexes the strings which actually changed.
+class UTILS_EXPORT TextIndex
+{
+public:
+    void set_texts(const int source, const QStringList &texts);
+    void set_text(const int source, const int index, const QString &text);
+    void remove_source(const int source);
+    QString text(const TextMatch &match) const;
+    // Matches are sorted by source, then by index. A negative "limit" returns every match.
+    QVector<TextMatch> find(const QString &query, const int limit = -1) const;
+
+private:
+    void update_entry(const int source, const int index, const QString &text);
+
+    mutable QReadWriteLock lock;
+    QHash<int, QStringList> texts;              // The original strings for each source
+    QHash<int, QStringList> folded_texts;       // Case-folded copies, which are what gets indexed
+    QHash<quint64, QSet<quint64>> postings;     // Trigram -> (source, index) key of every string containing it
+};
+
+#endif // TEXTINDEX_H
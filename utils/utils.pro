@@ -5,6 +5,7 @@
 #-------------------------------------------------
 
 QT       -= gui
+QT       += concurrent
 
 TARGET = utils
 TEMPLATE = lib
@@ -24,20 +25,36 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 SOURCES += \
     binarydata.cpp \
+    batch.cpp \
     wrd.cpp \
+    wrdcorpus.cpp \
     stx.cpp \
+    vfs.cpp \
     spc.cpp \
     dat.cpp \
-    srd.cpp
+    datcorpus.cpp \
+    datcsv.cpp \
+    srd.cpp \
+    stats.cpp \
+    stringpool.cpp \
+    textindex.cpp
 
 HEADERS += \
     utils_global.h \
     binarydata.h \
+    batch.h \
     wrd.h \
+    wrdcorpus.h \
     stx.h \
+    vfs.h \
     spc.h \
     dat.h \
-    srd.h
+    datcorpus.h \
+    datcsv.h \
+    srd.h \
+    stats.h \
+    stringpool.h \
+    textindex.h
 
 unix {
     target.path = /usr/lib
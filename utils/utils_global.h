@@ -11,6 +11,12 @@
 #  define UTILS_EXPORT Q_DECL_IMPORT
 #endif
 
+// SSE2 is always available on x86-64, but MSVC doesn't define __SSE2__
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define UTILS_SSE2
+#  include <emmintrin.h>
+#endif
+
 static QTextStream cout(stdout);
 
 // From https://graphics.stanford.edu/~seander/bithacks.html#ReverseByteWith64BitsDiv
@@ -0,0 +1,212 @@
+#include "vfs.h"
+#include "spc.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+// Splits "path" into the real file on disk, and the subfile names leading from it.
+static bool vfs_split(const QString &path, QString &real_path, QStringList &inner)
+{
+    QString current = QDir::cleanPath(QDir::fromNativeSeparators(path));
+    inner.clear();
+
+    while (!current.isEmpty())
+    {
+        const QFileInfo info(current);
+        if (info.exists())
+        {
+            real_path = current;
+            return info.isFile();
+        }
+
+        const int sep = current.lastIndexOf('/');
+        if (sep < 0)
+            return false;
+
+        inner.prepend(current.mid(sep + 1));
+        current = current.left(sep);
+    }
+
+    return false;
+}
+
+static bool parse_spc(const QByteArray &bytes, SpcFile &spc)
+{
+    try
+    {
+        spc = spc_from_bytes(bytes);
+    }
+    catch (...)
+    {
+        return false;
+    }
+    return true;
+}
+
+static int find_subfile(const SpcFile &spc, const QString &name)
+{
+    for (int i = 0; i < spc.subfiles.count(); ++i)
+    {
+        if (spc.subfiles.at(i).filename.compare(name, Qt::CaseInsensitive) == 0)
+            return i;
+    }
+    return -1;
+}
+
+// Opens the real file and walks down to the archive that directly contains the last subfile.
+static bool open_chain(const QString &real_path, const QStringList &inner, QVector<SpcFile> &chain)
+{
+    QFile f(real_path);
+    if (!f.open(QFile::ReadOnly))
+        return false;
+    QByteArray bytes = f.readAll();
+    f.close();
+
+    QString container = real_path;
+    for (int i = 0; i < inner.count(); ++i)
+    {
+        SpcFile spc;
+        if (!parse_spc(bytes, spc))
+            return false;
+        spc.filename = container;
+        chain.append(spc);
+
+        if (i + 1 < inner.count())
+        {
+            const int index = find_subfile(spc, inner.at(i));
+            if (index < 0)
+                return false;
+
+            bytes = spc_subfile_data_cached(spc.subfiles.at(index), container);
+            container += '/' + inner.at(i);
+        }
+    }
+
+    return true;
+}
+
+// Writes to a temporary file first, so a failed write leaves the old file intact.
+static bool save_file(const QString &path, const QByteArray &data)
+{
+    QSaveFile f(path);
+    if (!f.open(QFile::WriteOnly))
+        return false;
+    if (f.write(data) != data.size())
+    {
+        f.cancelWriting();
+        return false;
+    }
+    return f.commit();
+}
+
+bool vfs_exists(const QString &path)
+{
+    QString real_path;
+    QStringList inner;
+    if (!vfs_split(path, real_path, inner))
+        return false;
+    if (inner.isEmpty())
+        return true;
+
+    QVector<SpcFile> chain;
+    return open_chain(real_path, inner, chain) && find_subfile(chain.last(), inner.last()) >= 0;
+}
+
+bool vfs_read(const QString &path, QByteArray &data)
+{
+    QString real_path;
+    QStringList inner;
+    if (!vfs_split(path, real_path, inner))
+        return false;
+
+    if (inner.isEmpty())
+    {
+        QFile f(real_path);
+        if (!f.open(QFile::ReadOnly))
+            return false;
+        data = f.readAll();
+        f.close();
+        return true;
+    }
+
+    QVector<SpcFile> chain;
+    if (!open_chain(real_path, inner, chain))
+        return false;
+
+    const int index = find_subfile(chain.last(), inner.last());
+    if (index < 0)
+        return false;
+
+    data = spc_subfile_data_cached(chain.last().subfiles.at(index), chain.last().filename);
+    return true;
+}
+
+bool vfs_write(const QString &path, const QByteArray &data)
+{
+    QString real_path;
+    QStringList inner;
+    if (!vfs_split(path, real_path, inner) || inner.isEmpty())
+    {
+        // Either a plain file, or a new file in an existing directory
+        return save_file(path, data);
+    }
+
+    QVector<SpcFile> chain;
+    if (!open_chain(real_path, inner, chain))
+        return false;
+
+    // Put the new data in place, then repack each archive from the innermost outwards
+    QByteArray new_data = data;
+    for (int i = chain.count() - 1; i >= 0; --i)
+    {
+        SpcFile &spc = chain[i];
+        int index = find_subfile(spc, inner.at(i));
+        if (index < 0)
+        {
+            SpcSubfile subfile;
+            subfile.filename = inner.at(i);
+            subfile.cmp_flag = 0x02;
+            subfile.unk_flag = spc.subfiles.isEmpty() ? 0 : spc.subfiles.first().unk_flag;
+            spc.subfiles.append(subfile);
+            index = spc.subfiles.count() - 1;
+        }
+
+        SpcSubfile &subfile = spc.subfiles[index];
+
+        // External subfiles are SRD-compressed, which we can't do yet,
+        // and storing them inside the archive would leave the external file stale.
+        if (subfile.cmp_flag == 0x03)
+        {
+            cout << "Error: \"" << subfile.filename << "\" is stored in an external file, which can't be written yet.\n";
+            cout.flush();
+            return false;
+        }
+
+        subfile.dec_size = new_data.size();
+        subfile.name_len = subfile.filename.length();
+
+        // Keep uncompressed subfiles that way, otherwise only compress if it actually helps
+        const QByteArray cmp_data = (subfile.cmp_flag == 0x01) ? QByteArray() : spc_cmp(new_data);
+        if (subfile.cmp_flag == 0x01 || cmp_data.size() > new_data.size())
+        {
+            subfile.cmp_flag = 0x01;
+            subfile.data = new_data;
+        }
+        else
+        {
+            subfile.cmp_flag = 0x02;
+            subfile.data = cmp_data;
+        }
+        subfile.cmp_size = subfile.data.size();
+        subfile.offset = -1;
+
+        new_data = spc_to_bytes(spc);
+    }
+
+    // Modification times can be too coarse to tell the old and new archives apart
+    if (!save_file(real_path, new_data))
+        return false;
+    spc_clear_cache();
+    return true;
+}
@@ -0,0 +1,19 @@
+#ifndef VFS_H
+#define VFS_H
+
+#include "utils_global.h"
+#include "binarydata.h"
+
+// Paths may point inside SPC archives, like "chap1.spc/script.wrd", or even inside
+// archives stored in other archives, like "chap1.spc/inner.spc/script.wrd".
+// Subfiles are decompressed in memory (through the shared subfile cache),
+// so nothing needs to be extracted to disk first. Plain paths work as usual.
+UTILS_EXPORT bool vfs_exists(const QString &path);
+UTILS_EXPORT bool vfs_read(const QString &path, QByteArray &data);
+// Writing inside an archive compresses the new data and rewrites that archive,
+// along with every archive containing it. Missing subfiles are added.
+// The file on disk is only replaced once everything has been written.
+// Subfiles stored in external files (cmp_flag 0x03) can't be written, and return false.
+UTILS_EXPORT bool vfs_write(const QString &path, const QByteArray &data);
+
+#endif // VFS_H
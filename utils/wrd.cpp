@@ -1,10 +1,112 @@
 #include "wrd.h"
+#include "vfs.h"
 
 #include <QDebug>
 #include <QDir>
 #include <QFileInfo>
+#include <QtAlgorithms>
+#include <QtConcurrent/QtConcurrent>
 
-WrdFile wrd_from_bytes(const QByteArray &bytes, QString in_file)
+// KNOWN_CMDS is (currently) ordered by opcode, so we can usually index it directly.
+static const WrdCmd *find_known_cmd(const uchar opcode)
+{
+    const uint known_count = sizeof(KNOWN_CMDS) / sizeof(WrdCmd);
+    if (opcode < known_count && KNOWN_CMDS[opcode].opcode == opcode)
+        return &KNOWN_CMDS[opcode];
+
+    for (const WrdCmd &known_cmd : KNOWN_CMDS)
+    {
+        if (known_cmd.opcode == opcode)
+            return &known_cmd;
+    }
+
+    return nullptr;
+}
+
+// Byte-swap "unit_count" big-endian units from "data" into "units", and note
+// the index of every unit which starts a command (its high byte is 0x70).
+static void scan_code(const uchar *data, const int unit_count, ushort *units, QVector<int> &cmd_units)
+{
+    int i = 0;
+
+#ifdef UTILS_SSE2
+    // 8 units at a time
+    const __m128i marker = _mm_set1_epi8(0x70);
+    for (; i + 8 <= unit_count; i += 8)
+    {
+        const __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + (i * 2)));
+        const __m128i swapped = _mm_or_si128(_mm_slli_epi16(raw, 8), _mm_srli_epi16(raw, 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(units + i), swapped);
+
+        // Only the first (high) byte of each unit can be a command marker
+        uint mask = (uint)_mm_movemask_epi8(_mm_cmpeq_epi8(raw, marker)) & 0x5555;
+        while (mask != 0)
+        {
+            cmd_units.append(i + (qCountTrailingZeroBits(mask) / 2));
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    for (; i < unit_count; ++i)
+    {
+        units[i] = (ushort)((data[i * 2] << 8) | data[(i * 2) + 1]);
+        if (data[i * 2] == 0x70)
+            cmd_units.append(i);
+    }
+}
+
+// Scripts with less code than this aren't worth splitting across threads.
+static const int WRD_PARALLEL_DECODE_SIZE = 0x4000;
+
+// Get the [start, end) range of each label's code, using the label offset table.
+// Returns false if the table doesn't describe a sensible split of the code section
+// (for example, older versions of these tools wrote every offset as 0).
+static bool get_label_ranges(const QByteArray &bytes, QVector<QPair<int, int>> &ranges)
+{
+    const int header_end = 0x20;
+    if (bytes.size() < header_end)
+        return false;
+
+    int pos = 2;
+    const ushort label_count = num_from_bytes<ushort>(bytes, pos);
+    pos = 0x0C;
+    const uint code_end = num_from_bytes<uint>(bytes, pos);             // sublabel_offsets_ptr
+    const uint label_offsets_ptr = num_from_bytes<uint>(bytes, pos);
+
+    if (label_count == 0 || code_end < (uint)header_end || code_end > (uint)bytes.size()
+            || label_offsets_ptr + (label_count * 2) > (uint)bytes.size())
+        return false;
+
+    QVector<int> starts;
+    pos = label_offsets_ptr;
+    for (ushort i = 0; i < label_count; ++i)
+        starts.append(header_end + num_from_bytes<ushort>(bytes, pos));
+
+    // The first label should begin right at the start of the code,
+    // and every (non-empty) label should begin with a command.
+    if (starts.first() != header_end)
+        return false;
+
+    ranges.clear();
+    for (int i = 0; i < label_count; ++i)
+    {
+        const int start = starts.at(i);
+        const int end = (i + 1 < label_count) ? starts.at(i + 1) : (int)code_end;
+
+        if (end < start || end > (int)code_end)
+            return false;
+
+        if (end > start && (uchar)bytes.at(start) != 0x70)
+            return false;
+
+        ranges.append(qMakePair(start, end));
+    }
+
+    return true;
+}
+
+WrdFile wrd_from_bytes(const QByteArray &bytes, QString in_file, const bool load_external_strings)
 {
     WrdFile result;
     int pos = 0;
@@ -37,65 +139,47 @@ WrdFile wrd_from_bytes(const QByteArray &bytes, QString in_file)
 
 
     // Parse the code for each label.
-    // NOTE: As far as I can tell, this data can probably just be read
-    // sequentially, and then split after every occurrence of 0x7014.
-    // But let's do it the more complex way for now.
+    // The label offset table tells us where each label's code starts, so each
+    // label can be decoded on its own (in parallel, for large scripts).
+    // If the table isn't usable, just decode all of the code in one go.
     const int header_end = 0x20;
-    pos = header_end;
-
-    // We need at least 2 bytes for a command
-    while (pos + 1 < label_offsets_ptr)
+    QVector<QPair<int, int>> ranges;
+    if (!get_label_ranges(bytes, ranges))
     {
-        const uchar b = bytes.at(pos++);
-        if (b != 0x70)
-            continue;
-
-        const uchar op = bytes.at(pos++);
-        WrdCmd cmd;
-        cmd.name = "UNKNOWN_CMD";
-        cmd.opcode = op;
-
-        for (WrdCmd known_cmd : KNOWN_CMDS)
-        {
-            if (op == known_cmd.opcode)
-            {
-                cmd.name = known_cmd.name;
-                cmd.arg_types = known_cmd.arg_types;
-                break;
-            }
-        }
-
-        // We need at least 2 bytes for each arg
-        while (pos < sublabel_offsets_ptr - 1)
-        {
-            const ushort arg = num_from_bytes<ushort>(bytes, pos, true);
-
-            if ((uchar)(arg >> 8) == 0x70)
-            {
-                pos -= 2;
-                break;
-            }
-
-            cmd.args.append(arg);
-        }
-
-        if (cmd.arg_types.count() != cmd.args.count() && cmd.opcode != 0x01 && cmd.opcode != 0x03)  // IFF and IFW have variable-length params
-        {
-            //cout << in_file << ": Opcode " << num_to_hex(cmd.opcode, 2) << " expected " << cmd.arg_types.count() << " args, but found " << cmd.args.count() << ".";
-            //cout.flush();
-            qDebug() << in_file << ": Opcode " << num_to_hex(cmd.opcode, 2) << " expected " << cmd.arg_types.count() << " args, but found " << cmd.args.count() << ".";
+        const int code_end = std::max(header_end, std::min((int)sublabel_offsets_ptr, bytes.size()));
+        ranges.append(qMakePair(header_end, code_end));
+    }
 
-            /*
-            for (int i = cmd.arg_types.count(); i < cmd.args.count(); ++i)
-            {
-                cmd.arg_types.append(0);
-            }
-            */
-        }
+    QVector<QByteArray> blocks;
+    int code_size = 0;
+    for (const QPair<int, int> &range : ranges)
+    {
+        // We only need these while "bytes" is alive, so avoid copying the data
+        blocks.append(QByteArray::fromRawData(bytes.constData() + range.first, range.second - range.first));
+        code_size += range.second - range.first;
+    }
 
-        result.code.append(cmd);
+    QVector<QVector<WrdCmd>> label_code(blocks.count());
+    if (blocks.count() > 1 && code_size >= WRD_PARALLEL_DECODE_SIZE)
+    {
+        QVector<int> indexes;
+        for (int i = 0; i < blocks.count(); ++i)
+            indexes.append(i);
+
+        QVector<WrdCmd> *label_code_data = label_code.data();
+        QtConcurrent::blockingMap(indexes, [&](const int &i) {
+            label_code_data[i] = wrd_code_to_cmds(blocks.at(i), in_file);
+        });
+    }
+    else
+    {
+        for (int i = 0; i < blocks.count(); ++i)
+            label_code[i] = wrd_code_to_cmds(blocks.at(i), in_file);
     }
 
+    for (const QVector<WrdCmd> &cmds : label_code)
+        result.code.append(cmds);
+
 
     // Read sublabel offsets
     // NOTE: We don't actually need to do this, since we don't use this data for anything
@@ -127,11 +211,11 @@ WrdFile wrd_from_bytes(const QByteArray &bytes, QString in_file)
         pos = str_ptr;
         for (ushort i = 0; i < str_count; ++i)
         {
-            uint str_len = (uint)bytes.at(pos++);
+            uint str_len = (uchar)bytes.at(pos++);
 
             // ┐(´∀｀)┌
             if (str_len >= 0x80)
-                str_len += (bytes.at(pos++) - 1) * 0x80;
+                str_len += ((uchar)bytes.at(pos++) - 1) * 0x80;
 
             QString str = str_from_bytes(bytes, pos, -1, "UTF16LE");
             result.strings.append(str);
@@ -139,6 +223,10 @@ WrdFile wrd_from_bytes(const QByteArray &bytes, QString in_file)
 
         result.external_strings = false;
     }
+    else if (!load_external_strings)
+    {
+        result.external_strings = true;
+    }
     else                // Text is stored externally.
     {
         // Strings are stored in the "(current spc name)_text_(region).spc" file,
@@ -159,13 +247,17 @@ WrdFile wrd_from_bytes(const QByteArray &bytes, QString in_file)
         stx_file.append(QFileInfo(in_file).fileName());
         stx_file.replace(".wrd", ".stx");
 
-        if (QFileInfo(stx_file).exists())
+        // The text archive may be a real directory, or still packed as an SPC file.
+        QByteArray stx_data;
+        QString stx_error;
+        if (vfs_read(stx_file, stx_data) && stx_from_bytes(stx_data, result.external_stx, stx_error))
+        {
+            result.strings = result.external_stx.tables.first().strings;
+            result.external_stx.tables.first().strings.clear();
+        }
+        else
         {
-            QFile f(stx_file);
-            f.open(QFile::ReadOnly);
-            const QByteArray stx_data = f.readAll();
-            f.close();
-            result.strings = get_stx_strings(stx_data);
+            result.external_stx = StxFile();
         }
 
         result.external_strings = true;
@@ -174,95 +266,235 @@ WrdFile wrd_from_bytes(const QByteArray &bytes, QString in_file)
     return result;
 }
 
+QByteArray wrd_external_stx_to_bytes(const WrdFile &wrd)
+{
+    StxFile stx = wrd.external_stx;
+    if (stx.tables.isEmpty())
+        stx.tables.append(StxTable());
+    stx.tables.first().strings = wrd.strings;
+    return stx_to_bytes(stx);
+}
+
+QVector<QByteArray> wrd_label_code(const QByteArray &bytes)
+{
+    QVector<QByteArray> result;
+
+    QVector<QPair<int, int>> ranges;
+    if (!get_label_ranges(bytes, ranges))
+        return result;
+
+    for (const QPair<int, int> &range : ranges)
+        result.append(bytes.mid(range.first, range.second - range.first));
+
+    return result;
+}
+
+QVector<WrdCmd> wrd_code_to_cmds(const QByteArray &bytes, const QString &filename)
+{
+    QVector<WrdCmd> result;
+
+    // Everything in the code is made up of 2-byte big-endian units, and a command
+    // starts at any unit whose high byte is 0x70. Find them all in one pass,
+    // then slice each command's args straight out of the byte-swapped units.
+    const int unit_count = bytes.size() / 2;
+    QVector<ushort> units(unit_count);
+    QVector<int> cmd_units;
+    cmd_units.reserve(unit_count / 2);
+    scan_code(reinterpret_cast<const uchar*>(bytes.constData()), unit_count, units.data(), cmd_units);
+
+    result.reserve(cmd_units.count());
+    for (int c = 0; c < cmd_units.count(); ++c)
+    {
+        const int cmd_start = cmd_units.at(c);
+        const int cmd_end = (c + 1 < cmd_units.count()) ? cmd_units.at(c + 1) : unit_count;
+
+        WrdCmd cmd;
+        cmd.opcode = (uchar)(units.at(cmd_start) & 0xFF);
+
+        const WrdCmd *known_cmd = find_known_cmd(cmd.opcode);
+        if (known_cmd != nullptr)
+        {
+            cmd.name = known_cmd->name;
+            cmd.arg_types = known_cmd->arg_types;
+        }
+        else
+        {
+            cmd.name = "UNKNOWN_CMD";
+        }
+
+        const int arg_count = cmd_end - cmd_start - 1;
+        cmd.args.resize(arg_count);
+        std::copy(units.constData() + cmd_start + 1, units.constData() + cmd_end, cmd.args.data());
+
+        if (cmd.arg_types.count() != cmd.args.count() && cmd.opcode != 0x01 && cmd.opcode != 0x03)  // IFF and IFW have variable-length params
+        {
+            qDebug() << filename << ": Opcode " << num_to_hex(cmd.opcode, 2) << " expected " << cmd.arg_types.count() << " args, but found " << cmd.args.count() << ".";
+        }
+
+        result.append(cmd);
+    }
+
+    return result;
+}
+
 QByteArray wrd_to_bytes(const WrdFile &wrd_file)
 {
-    QByteArray result;
-
-    result.append(num_to_bytes((ushort)wrd_file.strings.count()));
-    result.append(num_to_bytes((ushort)wrd_file.labels.count()));
-    result.append(num_to_bytes((ushort)wrd_file.params.count()));
-    //result.append(num_to_bytes((ushort)wrd_file.sublabel_offsets.count()));
-
-    QByteArray code_data;
-    QByteArray code_offsets;
-    QByteArray label_names_data;
-    QVector<ushort> sublabel_offsets;
-    for (int i = 0; i < wrd_file.labels.count(); ++i)
+    const int header_end = 0x20;
+
+    // Calculate the size of every section first, so we can allocate
+    // the whole file at once and write each section in place.
+    int code_size = 0;
+    int sublabel_count = 0;
+    for (const WrdCmd &cmd : wrd_file.code)
     {
-        const QByteArray lbldata = str_to_bytes(wrd_file.labels.at(i));
-        label_names_data.append((uchar)(lbldata.size() - 1));
-        label_names_data.append(lbldata);
+        if (cmd.opcode == 0x4A) // "LBN"
+            ++sublabel_count;
 
-        code_offsets.append(num_to_bytes((ushort)code_data.size()));
+        code_size += 2 + (cmd.args.count() * 2);
     }
 
-    for (const WrdCmd cmd : wrd_file.code)
+    QVector<QByteArray> label_names_data;
+    label_names_data.reserve(wrd_file.labels.count());
+    int label_names_size = 0;
+    for (const QString &label : wrd_file.labels)
     {
-        // Re-calculate sublabel offsets
+        label_names_data.append(label.toUtf8());
+        label_names_size += label_names_data.last().size() + 2; // Length byte + null terminator
+    }
+
+    QVector<QByteArray> flags_data;
+    flags_data.reserve(wrd_file.params.count());
+    int flags_size = 0;
+    for (const QString &flag : wrd_file.params)
+    {
+        flags_data.append(flag.toUtf8());
+        flags_size += flags_data.last().size() + 2;             // Length byte + null terminator
+    }
+
+    int strings_size = 0;
+    if (!wrd_file.external_strings)
+    {
+        for (const QString &str : wrd_file.strings)
+        {
+            // Length prefix (1 or 2 bytes), then the UTF-16 string + null terminator
+            strings_size += ((str.size() >= 0x80) ? 2 : 1) + ((str.size() + 1) * 2);
+        }
+    }
+
+    const uint sublabel_offsets_ptr = header_end + code_size;
+    const uint code_offsets_ptr = sublabel_offsets_ptr + (sublabel_count * 4);
+    const uint label_names_ptr = code_offsets_ptr + (wrd_file.labels.count() * 2);
+    const uint flags_ptr = label_names_ptr + label_names_size;
+    const uint str_ptr = wrd_file.external_strings ? 0 : flags_ptr + flags_size;
+
+    QByteArray result(flags_ptr + flags_size + strings_size, 0x00);
+    char *out = result.data();
+    int pos = 0;
+
+
+    // Header
+    num_to_buf((ushort)wrd_file.strings.count(), out, pos);
+    num_to_buf((ushort)wrd_file.labels.count(), out, pos);
+    num_to_buf((ushort)wrd_file.params.count(), out, pos);
+    num_to_buf((ushort)sublabel_count, out, pos);
+    pos += 4;                                       // padding
+    num_to_buf(sublabel_offsets_ptr, out, pos);
+    num_to_buf(code_offsets_ptr, out, pos);
+    num_to_buf(label_names_ptr, out, pos);
+    num_to_buf(flags_ptr, out, pos);
+    num_to_buf(str_ptr, out, pos);
+
+
+    // Code, re-calculating the label and sublabel offsets as we go
+    QVector<int> label_offsets(wrd_file.labels.count(), -1);
+    int sublabel_pos = sublabel_offsets_ptr;
+    ushort sublabel_num = 0;
+    for (const WrdCmd &cmd : wrd_file.code)
+    {
+        if (cmd.opcode == 0x14 && !cmd.args.isEmpty()) // "LAB"
+        {
+            const ushort label_num = cmd.args.at(0);
+            if (label_num < label_offsets.count() && label_offsets.at(label_num) == -1)
+                label_offsets[label_num] = pos - header_end;
+        }
+
         if (cmd.opcode == 0x4A) // "LBN"
         {
-            // The current data size value is also equal to
-            // the current opcode's location.
-            sublabel_offsets.append(code_data.size());
+            // The current position relative to the start of the code
+            // is also equal to the current opcode's location.
+            num_to_buf(sublabel_num++, out, sublabel_pos);                  // sublabel number
+            num_to_buf((ushort)(pos - header_end), out, sublabel_pos);      // sublabel offset
         }
 
-        code_data.append((uchar)0x70);
-        code_data.append(cmd.opcode);
+        out[pos++] = (char)0x70;
+        out[pos++] = (char)cmd.opcode;
         for (const ushort arg : cmd.args)
         {
-            code_data.append(num_to_bytes(arg, true));
+            num_to_buf(arg, out, pos, true);
         }
     }
 
-    result.append(num_to_bytes((ushort)sublabel_offsets.count()));
-    result.append(QByteArray(4, 0x00));
-    QByteArray sublabel_offsets_bytes;
-    for (int i = 0; i < sublabel_offsets.count(); ++i)
+
+    // Label code offsets
+    // A label without a "LAB" command is treated as empty,
+    // so it starts wherever the next label does.
+    int next_offset = code_size;
+    for (int i = label_offsets.count() - 1; i >= 0; --i)
     {
-        sublabel_offsets_bytes.append(num_to_bytes<ushort>(i));                 // sublabel number
-        sublabel_offsets_bytes.append(num_to_bytes(sublabel_offsets.at(i)));    // sublabel offset
+        if (label_offsets.at(i) == -1)
+            label_offsets[i] = next_offset;
+        next_offset = label_offsets.at(i);
     }
 
-
-    QByteArray flags_data;
-    for (const QString flag : wrd_file.params)
+    pos = code_offsets_ptr;
+    for (const int offset : label_offsets)
     {
-        const QByteArray flagdata = str_to_bytes(flag);
-        flags_data.append((uchar)(flagdata.size() - 1));
-        flags_data.append(flagdata);
+        num_to_buf((ushort)offset, out, pos);
     }
 
 
-    const uint header_end = 0x20;
-    const uint sublabel_offsets_ptr = header_end + code_data.size();
-    result.append(num_to_bytes(sublabel_offsets_ptr));  // sublabel_offsets_ptr
-    const uint code_offsets_ptr = sublabel_offsets_ptr + sublabel_offsets_bytes.size();
-    result.append(num_to_bytes(code_offsets_ptr));      // code_offsets_ptr
-    const uint label_names_ptr = code_offsets_ptr + code_offsets.size();
-    result.append(num_to_bytes(label_names_ptr));       // label_names_ptr
-    const uint flags_ptr = label_names_ptr + label_names_data.size();
-    result.append(num_to_bytes(flags_ptr));             // flags_ptr
+    // Label names
+    for (const QByteArray &label : label_names_data)
+    {
+        out[pos++] = (char)label.size();
+        std::copy(label.begin(), label.end(), out + pos);
+        pos += label.size() + 1;                    // Null terminator is already zeroed
+    }
 
-    uint str_ptr = 0;
-    if (!wrd_file.external_strings)
-        str_ptr = flags_ptr + flags_data.size();
-    result.append(num_to_bytes(str_ptr));
 
+    // Params
+    for (const QByteArray &flag : flags_data)
+    {
+        out[pos++] = (char)flag.size();
+        std::copy(flag.begin(), flag.end(), out + pos);
+        pos += flag.size() + 1;
+    }
 
 
-    // Now that the offsets/ptrs to the data have been calculated, append the actual data
-    result.append(code_data);
-    result.append(sublabel_offsets_bytes);
-    result.append(code_offsets);
-    result.append(label_names_data);
-    result.append(flags_data);
+    // Text strings
     if (!wrd_file.external_strings)
     {
-        for (const QString str : wrd_file.strings)
+        for (const QString &str : wrd_file.strings)
         {
-            const QByteArray strdata = str_to_bytes(str);
-            result.append((uchar)(strdata.size() - 1));
-            result.append(str_to_bytes(str, true));
+            const int str_len = str.size();
+
+            // ┐(´∀｀)┌
+            if (str_len >= 0x80)
+            {
+                out[pos++] = (char)(0x80 | (str_len & 0x7F));
+                out[pos++] = (char)(str_len >> 7);
+            }
+            else
+            {
+                out[pos++] = (char)str_len;
+            }
+
+            const ushort *utf16 = str.utf16();
+            for (int i = 0; i < str_len; ++i)
+            {
+                num_to_buf(utf16[i], out, pos);
+            }
+            pos += 2;                               // Null terminator
         }
     }
 
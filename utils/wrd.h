@@ -99,14 +99,21 @@ struct UTILS_EXPORT WrdFile
     QStringList labels;
     QStringList params;
     QStringList strings;
+    // The external STX file's language and table info, with its string IDs kept in step
+    // with "strings" (the strings themselves only live in "strings").
+    StxFile external_stx;
     QVector<WrdCmd> code;
     //QVector<ushort> sublabel_offsets;
     bool external_strings;
 };
 
-UTILS_EXPORT WrdFile wrd_from_bytes(const QByteArray &bytes, QString filename);
+// If "load_external_strings" is false, the external STX file isn't read, and "strings" is left empty.
+UTILS_EXPORT WrdFile wrd_from_bytes(const QByteArray &bytes, QString filename, const bool load_external_strings = true);
 UTILS_EXPORT QByteArray wrd_to_bytes(const WrdFile &wrd);
-//UTILS_EXPORT QVector<WrdCmd> wrd_code_to_cmds(const QByteArray &bytes);
+// Builds the external STX file for "wrd.strings", keeping the language and string IDs it was loaded with.
+UTILS_EXPORT QByteArray wrd_external_stx_to_bytes(const WrdFile &wrd);
+UTILS_EXPORT QVector<QByteArray> wrd_label_code(const QByteArray &bytes);
+UTILS_EXPORT QVector<WrdCmd> wrd_code_to_cmds(const QByteArray &bytes, const QString &filename = QString());
 //UTILS_EXPORT QByteArray wrd_cmds_to_code(const QByteArray &wrd);
 
 #endif // WRD_H
@@ -0,0 +1,98 @@
+#include "wrdcorpus.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QtConcurrent/QtConcurrent>
+
+WrdCorpus wrd_corpus_load(const QString &dirpath)
+{
+    WrdCorpus corpus;
+    corpus.root = dirpath;
+    corpus.names = QSharedPointer<StringPool>::create();
+
+    QDirIterator it(dirpath, QStringList() << "*.wrd", QDir::Files, QDirIterator::Subdirectories);
+    QStringList filepaths;
+    while (it.hasNext())
+        filepaths.append(it.next());
+    filepaths.sort();
+
+    QVector<int> indexes;
+    for (int i = 0; i < filepaths.count(); ++i)
+        indexes.append(i);
+
+    // Each file only ever writes to its own slot, so no locking is needed.
+    QVector<WrdFile> loaded(filepaths.count());
+    QVector<QString> load_errors(filepaths.count());
+    WrdFile *loaded_data = loaded.data();
+    QString *error_data = load_errors.data();
+    QtConcurrent::blockingMap(indexes, [&](const int &i) {
+        QFile f(filepaths.at(i));
+        if (!f.open(QFile::ReadOnly))
+        {
+            error_data[i] = "Failed to open file.";
+            return;
+        }
+        const QByteArray bytes = f.readAll();
+        f.close();
+
+        loaded_data[i] = wrd_from_bytes(bytes, filepaths.at(i), false);
+    });
+
+    // Intern the names in file order, so the handles don't depend on thread scheduling.
+    // Each file's own string lists are dropped as soon as they've been interned.
+    corpus.files.reserve(filepaths.count());
+    for (int i = 0; i < filepaths.count(); ++i)
+    {
+        const QString filename = QDir(dirpath).relativeFilePath(filepaths.at(i));
+        if (!load_errors.at(i).isEmpty())
+        {
+            corpus.errors.append(filename + ": " + load_errors.at(i));
+            continue;
+        }
+
+        WrdFile &wrd = loaded[i];
+        WrdCorpusFile file;
+        file.filename = filename;
+
+        file.labels.reserve(wrd.labels.count());
+        for (const QString &label : wrd.labels)
+            file.labels.append(corpus.names->intern(label));
+
+        file.params.reserve(wrd.params.count());
+        for (const QString &param : wrd.params)
+            file.params.append(corpus.names->intern(param));
+
+        file.code.swap(wrd.code);
+        wrd = WrdFile();
+
+        corpus.files.append(file);
+    }
+
+    return corpus;
+}
+
+QVector<WrdParamUse> wrd_corpus_find_param(const WrdCorpus &corpus, const QString &name)
+{
+    QVector<WrdParamUse> result;
+
+    StrHandle handle;
+    if (corpus.names.isNull() || !corpus.names->find(name, handle))
+        return result;
+
+    for (int f = 0; f < corpus.files.count(); ++f)
+    {
+        const WrdCorpusFile &file = corpus.files.at(f);
+        for (int c = 0; c < file.code.count(); ++c)
+        {
+            const WrdCmd &cmd = file.code.at(c);
+            for (int a = 0; a < cmd.args.count() && a < cmd.arg_types.count(); ++a)
+            {
+                const ushort arg = cmd.args.at(a);
+                if (cmd.arg_types.at(a) == 0 && arg < file.params.count() && file.params.at(arg) == handle)
+                    result.append({f, c, a});
+            }
+        }
+    }
+
+    return result;
+}
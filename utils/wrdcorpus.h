@@ -0,0 +1,43 @@
+#ifndef WRDCORPUS_H
+#define WRDCORPUS_H
+
+#include "utils_global.h"
+#include "stringpool.h"
+#include "wrd.h"
+#include <QSharedPointer>
+
+// One script in a WrdCorpus. Labels and params are handles into the corpus's
+// StringPool instead of strings, and the script's text isn't loaded at all.
+struct UTILS_EXPORT WrdCorpusFile
+{
+    QString filename;               // Relative to the corpus root
+    QVector<StrHandle> labels;
+    QVector<StrHandle> params;
+    QVector<WrdCmd> code;
+};
+
+// Every WRD script under a directory, for analysis. The same label and param names
+// (character names, map IDs, "non", etc) repeat across thousands of scripts, so they're
+// interned in a StringPool owned by the corpus: each name is only stored once, and
+// comparing names is just comparing handles. The pool is freed along with the corpus.
+// The editors work on plain WrdFiles, and don't use any of this.
+struct UTILS_EXPORT WrdCorpus
+{
+    QString root;
+    QSharedPointer<StringPool> names;
+    QVector<WrdCorpusFile> files;
+    QStringList errors;             // "filename: error" for each file which couldn't be loaded
+};
+
+struct UTILS_EXPORT WrdParamUse
+{
+    int file;
+    int cmd;
+    int arg;
+};
+
+UTILS_EXPORT WrdCorpus wrd_corpus_load(const QString &dirpath);
+// Finds every command argument (in any file) which refers to the param called "name".
+UTILS_EXPORT QVector<WrdParamUse> wrd_corpus_find_param(const WrdCorpus &corpus, const QString &name);
+
+#endif // WRDCORPUS_H
@@ -0,0 +1,69 @@
+#include "searchdock.h"
+
+#include <QVBoxLayout>
+#include "../utils/binarydata.h"
+
+SearchDock::SearchDock(const QString &placeholder, QWidget *parent) : QDockWidget("Search", parent)
+{
+    setObjectName("searchDock");
+
+    searchBox = new QLineEdit(this);
+    searchBox->setPlaceholderText(placeholder);
+    searchBox->setClearButtonEnabled(true);
+    searchResults = new QListWidget(this);
+
+    QWidget *searchWidget = new QWidget(this);
+    QVBoxLayout *searchLayout = new QVBoxLayout(searchWidget);
+    searchLayout->setContentsMargins(0, 0, 0, 0);
+    searchLayout->addWidget(searchBox);
+    searchLayout->addWidget(searchResults);
+    setWidget(searchWidget);
+
+    matchLabel = [](const TextMatch &match) { return num_to_hex(match.index, 4); };
+
+    connect(searchBox, &QLineEdit::textChanged, this, &SearchDock::runSearch);
+    connect(searchResults, &QListWidget::itemActivated, this, &SearchDock::activateResult);
+}
+
+void SearchDock::setMatchLabel(std::function<QString(const TextMatch &match)> label)
+{
+    matchLabel = label;
+    runSearch();
+}
+
+void SearchDock::setTexts(const int source, const QStringList &texts)
+{
+    // Only the entries which actually changed get re-indexed
+    searchIndex.set_texts(source, texts);
+    runSearch();
+}
+
+void SearchDock::setText(const int source, const int index, const QString &text)
+{
+    searchIndex.set_text(source, index, text);
+    runSearch();
+}
+
+void SearchDock::runSearch()
+{
+    searchResults->clear();
+    if (searchBox->text().isEmpty())
+        return;
+
+    const QVector<TextMatch> matches = searchIndex.find(searchBox->text(), 1000);
+    for (const TextMatch &match : matches)
+    {
+        QString text = searchIndex.text(match);
+        text.replace("\n", "\\n");
+
+        QListWidgetItem *item = new QListWidgetItem(matchLabel(match) + ": " + text);
+        item->setData(Qt::UserRole, match.source);
+        item->setData(Qt::UserRole + 1, match.index);
+        searchResults->addItem(item);
+    }
+}
+
+void SearchDock::activateResult(QListWidgetItem *item)
+{
+    emit matchActivated(item->data(Qt::UserRole).toInt(), item->data(Qt::UserRole + 1).toInt());
+}
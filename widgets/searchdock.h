@@ -0,0 +1,40 @@
+#ifndef SEARCHDOCK_H
+#define SEARCHDOCK_H
+
+#include <QDockWidget>
+#include <QLineEdit>
+#include <QListWidget>
+#include <functional>
+#include "../utils/textindex.h"
+
+// The "Search" dock shared by the editors. It owns a TextIndex which the editor
+// keeps up to date, shows the matches for whatever's typed into it, and emits
+// matchActivated() when one of them is picked so the editor can jump to it.
+class SearchDock : public QDockWidget
+{
+    Q_OBJECT
+
+public:
+    explicit SearchDock(const QString &placeholder, QWidget *parent = 0);
+    // Used to label each result in front of its text. Defaults to the match's index in hex.
+    void setMatchLabel(std::function<QString(const TextMatch &match)> label);
+    void setTexts(const int source, const QStringList &texts);
+    void setText(const int source, const int index, const QString &text);
+
+signals:
+    void matchActivated(int source, int index);
+
+public slots:
+    void runSearch();
+
+private slots:
+    void activateResult(QListWidgetItem *item);
+
+private:
+    TextIndex searchIndex;
+    QLineEdit *searchBox;
+    QListWidget *searchResults;
+    std::function<QString(const TextMatch &match)> matchLabel;
+};
+
+#endif // SEARCHDOCK_H
@@ -0,0 +1,10 @@
+# Widgets shared between the editors. Include this from an editor's .pro file.
+
+SOURCES += \
+    $$PWD/searchdock.cpp
+
+HEADERS += \
+    $$PWD/searchdock.h
+
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
@@ -8,19 +8,25 @@
 #include <QMessageBox>
 #include <QMimeData>
 #include <QTableView>
+#include "../utils/vfs.h"
 
 MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MainWindow)
 {
     ui->setupUi(this);
     //ui->tableCode->setColumnWidth(1, 180);
 
+    searchDock = new SearchDock("Search parameters and strings", this);
+    searchDock->setMatchLabel([this](const TextMatch &match) { return ui->tabWidget->tabText(match.source).remove('&') + " " + num_to_hex(match.index, 4); });
+    addDockWidget(Qt::RightDockWidgetArea, searchDock);
+    connect(searchDock, &SearchDock::matchActivated, this, &MainWindow::showSearchResult);
+
     QStringList args = QApplication::arguments();
     if (args.count() <= 1)
         return;
 
     for (int i = 1; i < args.count(); ++i)
     {
-        if (QFileInfo(args[i]).exists() && args[i].endsWith(".wrd", Qt::CaseInsensitive))
+        if (vfs_exists(args[i]) && args[i].endsWith(".wrd", Qt::CaseInsensitive))
         {
             openFile(args[i]);
             break;
@@ -92,11 +98,11 @@ bool MainWindow::openFile(QString newFilepath)
     }
     if (newFilepath.isEmpty()) return false;
 
-    QFile f(newFilepath);
-    if (!f.open(QFile::ReadOnly)) return false;
+    // The path may also point inside an SPC archive, like "chap1.spc/script.wrd"
+    QByteArray in_data;
+    if (!vfs_read(newFilepath, in_data)) return false;
 
-    currentWrd = wrd_from_bytes(f.readAll(), newFilepath);
-    f.close();
+    currentWrd = wrd_from_bytes(in_data, newFilepath);
 
     this->setWindowTitle("WRD Editor: " + QFileInfo(newFilepath).fileName());
 
@@ -107,6 +113,21 @@ bool MainWindow::openFile(QString newFilepath)
     QObject::connect(code, &WrdUiModel::editCompleted, this, &MainWindow::on_editCompleted);
     QObject::connect(params, &WrdUiModel::editCompleted, this, &MainWindow::on_editCompleted);
     QObject::connect(strings, &WrdUiModel::editCompleted, this, &MainWindow::on_editCompleted);
+
+    // The parsed args in the code table show param/string text, so re-format them when those change
+    for (WrdUiModel *model : {params, strings})
+    {
+        QObject::connect(model, &WrdUiModel::editCompleted, code, &WrdUiModel::clearCache);
+        QObject::connect(model, &WrdUiModel::rowsInserted, code, &WrdUiModel::clearCache);
+        QObject::connect(model, &WrdUiModel::rowsRemoved, code, &WrdUiModel::clearCache);
+        QObject::connect(model, &WrdUiModel::rowsMoved, code, &WrdUiModel::clearCache);
+
+        QObject::connect(model, &WrdUiModel::editCompleted, this, &MainWindow::updateSearchIndex);
+        QObject::connect(model, &WrdUiModel::rowsInserted, this, &MainWindow::updateSearchIndex);
+        QObject::connect(model, &WrdUiModel::rowsRemoved, this, &MainWindow::updateSearchIndex);
+        QObject::connect(model, &WrdUiModel::rowsMoved, this, &MainWindow::updateSearchIndex);
+    }
+    updateSearchIndex();
     ui->tableCode->setModel(code);
     ui->tableParams->setModel(params);
     ui->tableStrings->setModel(strings);
@@ -138,12 +159,8 @@ bool MainWindow::saveFile(QString newFilepath)
     }
     */
 
-    QFile f(newFilepath);
-    if (!f.open(QFile::WriteOnly)) return false;
-
     const QByteArray out_data = wrd_to_bytes(currentWrd);
-    f.write(out_data);
-    f.close();
+    if (!vfs_write(newFilepath, out_data)) return false;
 
     // If the strings are internal, we've saved them already in wrd_to_bytes()
     if (currentWrd.external_strings && currentWrd.strings.count() > 0)
@@ -166,11 +183,12 @@ bool MainWindow::saveFile(QString newFilepath)
         stx_file.append(QFileInfo(newFilepath).fileName());
         stx_file.replace(".wrd", ".stx");
 
-        const QByteArray stx_data = repack_stx_strings(currentWrd.strings);
-        QFile f2(stx_file);
-        f2.open(QFile::WriteOnly);
-        f2.write(stx_data);
-        f2.close();
+        const QByteArray stx_data = wrd_external_stx_to_bytes(currentWrd);
+        if (!vfs_write(stx_file, stx_data))
+        {
+            QMessageBox::critical(this, "Error", "Failed to save the strings to \"" + stx_file + "\".");
+            return false;
+        }
     }
 
     currentWrd.filename = newFilepath;
@@ -229,6 +247,25 @@ void MainWindow::on_comboBox_SelectLabel_currentIndexChanged(int index)
 
 
 
+void MainWindow::updateSearchIndex()
+{
+    searchDock->setTexts(1, currentWrd.params);
+    searchDock->setTexts(2, currentWrd.strings);
+}
+
+void MainWindow::showSearchResult(int source, int row)
+{
+    ui->tabWidget->setCurrentIndex(source);
+    QTableView *table = ui->tabWidget->currentWidget()->findChild<QTableView *>(QString(), Qt::FindDirectChildrenOnly);
+
+    // Large tables are loaded in chunks, so make sure the row is actually there
+    while (row >= table->model()->rowCount() && table->model()->canFetchMore(QModelIndex()))
+        table->model()->fetchMore(QModelIndex());
+
+    table->selectRow(row);
+    table->scrollTo(table->model()->index(row, 1));
+}
+
 void MainWindow::on_editCompleted(const QString & /*str*/)
 {
     unsavedChanges = true;
@@ -7,6 +7,7 @@
 #include <QDropEvent>
 #include <QMimeData>
 #include "wrd_ui_model.h"
+#include "../widgets/searchdock.h"
 
 namespace Ui {
 class MainWindow;
@@ -40,6 +41,8 @@ private slots:
     void on_actionCN_toggled(bool checked);
     void dragEnterEvent(QDragEnterEvent *event);
     void dropEvent(QDropEvent *event);
+    void updateSearchIndex();
+    void showSearchResult(int source, int row);
 
 private:
     bool confirmUnsaved();
@@ -51,6 +54,7 @@ private:
 
     Ui::MainWindow *ui;
     bool unsavedChanges = false;
+    SearchDock *searchDock;     // Sources are the tab/model indexes: 1 = params, 2 = strings
 };
 
 #endif // MAINWINDOW_H
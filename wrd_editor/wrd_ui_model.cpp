@@ -1,13 +1,26 @@
 #include "wrd_ui_model.h"
 #include <QMessageBox>
 
+// Huge scripts are handed to the view a chunk at a time, as it scrolls down.
+static const int ROWS_PER_FETCH = 1024;
+
 WrdUiModel::WrdUiModel(QObject * /*parent*/, WrdFile *file, const int mode)
 {
     wrd_file = file;
     data_mode = mode;
+    loaded_rows = qMin(totalRowCount(), ROWS_PER_FETCH);
+    row_cache.resize(loaded_rows);
 }
 
-int WrdUiModel::rowCount(const QModelIndex & /*parent*/) const
+QVector<uint> *WrdUiModel::externalStringIds()
+{
+    if (!(*wrd_file).external_strings || (*wrd_file).external_stx.tables.isEmpty())
+        return nullptr;
+
+    return &(*wrd_file).external_stx.tables.first().ids;
+}
+
+int WrdUiModel::totalRowCount() const
 {
     switch (data_mode)
     {
@@ -25,6 +38,11 @@ int WrdUiModel::rowCount(const QModelIndex & /*parent*/) const
     }
 }
 
+int WrdUiModel::rowCount(const QModelIndex & /*parent*/) const
+{
+    return loaded_rows;
+}
+
 int WrdUiModel::columnCount(const QModelIndex & /*parent*/) const
 {
     switch (data_mode)
@@ -41,91 +59,108 @@ int WrdUiModel::columnCount(const QModelIndex & /*parent*/) const
     }
 }
 
-QVariant WrdUiModel::data(const QModelIndex &index, int role) const
+bool WrdUiModel::canFetchMore(const QModelIndex &parent) const
 {
-    if (role != Qt::DisplayRole && role != Qt::EditRole)
-        return QVariant();
+    return !parent.isValid() && loaded_rows < totalRowCount();
+}
 
-    const int row = index.row();
-    const int col = index.column();
+void WrdUiModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid())
+        return;
+
+    const int count = qMin(totalRowCount() - loaded_rows, ROWS_PER_FETCH);
+    if (count <= 0)
+        return;
 
+    beginInsertRows(QModelIndex(), loaded_rows, loaded_rows + (count - 1));
+    loaded_rows += count;
+    row_cache.resize(loaded_rows);
+    endInsertRows();
+}
+
+void WrdUiModel::clearCache()
+{
+    for (QStringList &cached : row_cache)
+        cached.clear();
+
+    if (loaded_rows > 0)
+        emit dataChanged(index(0, 0), index(loaded_rows - 1, columnCount() - 1));
+}
+
+QStringList WrdUiModel::formatRow(const int row) const
+{
     switch (data_mode)
     {
     case 0:
     {
-        const WrdCmd cmd = (*wrd_file).code.at(row);
+        const WrdCmd &cmd = (*wrd_file).code.at(row);
 
-        if (col == 0)       // Opcode
-        {
-            return num_to_hex(cmd.opcode, 2);
-        }
-        else if (col == 1)  // Parameter data
-        {
-            QString argHexString;
-            for (ushort arg : cmd.args)
-                argHexString += num_to_hex(arg, 4);
-            return argHexString.simplified();
-        }
-        else                // Parsed parameters
-        {
-            QString argParsedString;
-            argParsedString += cmd.name;
+        QString argHexString;
+        for (ushort arg : cmd.args)
+            argHexString += num_to_hex(arg, 4);
 
-            if (cmd.args.count() > 0 && !cmd.name.endsWith("="))
-                argParsedString += ":";
+        QString argParsedString;
+        argParsedString += cmd.name;
 
-            argParsedString += "    ";
+        if (cmd.args.count() > 0 && !cmd.name.endsWith("="))
+            argParsedString += ":";
 
-            for (int a = 0; a < cmd.args.count(); a++)
-            {
-                const ushort arg = cmd.args.at(a);
-
-                if (cmd.arg_types.at(a) == 0 && a < cmd.arg_types.count() && arg < (*wrd_file).params.count())
-                    argParsedString += (*wrd_file).params.at(arg) + "    ";
-                else if (cmd.arg_types.at(a) == 2 && a < cmd.arg_types.count() && arg < (*wrd_file).strings.count())
-                    argParsedString += "\"" + (*wrd_file).strings.at(arg) + "\"    ";
-                else if (cmd.arg_types.at(a) == 3 && a < cmd.arg_types.count() && arg < (*wrd_file).labels.count())
-                    argParsedString += "\"" + (*wrd_file).labels.at(arg) + "\"    ";
-                else
-                    argParsedString += QString::number(arg) + "    ";
-            }
+        argParsedString += "    ";
 
-            argParsedString.replace("\n", "\\n");
-            return argParsedString.trimmed();
-        }
-        break;
-    }
-    case 1:
-    {
-        if (col == 0)
+        for (int a = 0; a < cmd.args.count(); a++)
         {
-            // Display hex index headers
-            return num_to_hex(row, 4);
+            const ushort arg = cmd.args.at(a);
+            const int arg_type = (a < cmd.arg_types.count()) ? cmd.arg_types.at(a) : -1;
+
+            if (arg_type == 0 && arg < (*wrd_file).params.count())
+                argParsedString += (*wrd_file).params.at(arg) + "    ";
+            else if (arg_type == 2 && arg < (*wrd_file).strings.count())
+                argParsedString += "\"" + (*wrd_file).strings.at(arg) + "\"    ";
+            else if (arg_type == 3 && arg < (*wrd_file).labels.count())
+                argParsedString += "\"" + (*wrd_file).labels.at(arg) + "\"    ";
+            else
+                argParsedString += QString::number(arg) + "    ";
         }
-        else
-        {
-            return (*wrd_file).params.at(row);
-        }
-        break;
+
+        argParsedString.replace("\n", "\\n");
+        return QStringList() << num_to_hex(cmd.opcode, 2) << argHexString.simplified() << argParsedString.trimmed();
     }
+    case 1:
+        return QStringList() << (*wrd_file).params.at(row);
+
     case 2:
     {
-        if (col == 0)
-        {
-            // Display hex index headers
-            return num_to_hex(row, 4);
-        }
-        else
-        {
-            QString str = (*wrd_file).strings.at(row);
-            str.replace("\n", "\\n");
-            return str;
-        }
-        break;
+        QString str = (*wrd_file).strings.at(row);
+        str.replace("\n", "\\n");
+        return QStringList() << str;
     }
     }
 
-    return QVariant();
+    return QStringList();
+}
+
+QVariant WrdUiModel::data(const QModelIndex &index, int role) const
+{
+    if (role != Qt::DisplayRole && role != Qt::EditRole)
+        return QVariant();
+
+    const int row = index.row();
+    const int col = index.column();
+    if (row < 0 || row >= row_cache.count())
+        return QVariant();
+
+    // Display hex index headers
+    if (data_mode != 0 && col == 0)
+        return num_to_hex(row, 4);
+
+    QStringList &cached = row_cache[row];
+    if (cached.isEmpty())
+        cached = formatRow(row);
+
+    if (data_mode == 0)
+        return cached.value(col);
+    return cached.value(0);
 }
 
 QVariant WrdUiModel::headerData(int section, Qt::Orientation orientation, int role) const
@@ -262,6 +297,8 @@ bool WrdUiModel::setData(const QModelIndex &index, const QVariant &value, int ro
     }
     }
 
+    row_cache[row].clear();
+    emit dataChanged(this->index(row, 0), this->index(row, columnCount() - 1));
     emit(editCompleted(value.toString()));
     return true;
 }
@@ -287,10 +324,22 @@ bool WrdUiModel::insertRows(int row, int count, const QModelIndex & /*parent*/)
             break;
 
         case 2:
+        {
             (*wrd_file).strings.insert(row + r, QString());
+
+            // Give new external strings an ID nothing else is using
+            QVector<uint> *ids = externalStringIds();
+            if (ids != nullptr && row + r <= ids->count())
+            {
+                const uint new_id = ids->isEmpty() ? 0 : *std::max_element(ids->begin(), ids->end()) + 1;
+                ids->insert(row + r, new_id);
+            }
             break;
         }
+        }
+        row_cache.insert(row + r, QStringList());
     }
+    loaded_rows += count;
     endInsertRows();
 
     return true;
@@ -317,11 +366,18 @@ bool WrdUiModel::removeRows(int row, int count, const QModelIndex & /*parent*/)
             break;
 
         case 2:
+        {
             (*wrd_file).strings.removeAt(row);
+
+            QVector<uint> *ids = externalStringIds();
+            if (ids != nullptr && row < ids->count())
+                ids->removeAt(row);
             break;
         }
-
+        }
+        row_cache.removeAt(row);
     }
+    loaded_rows -= count;
     endRemoveRows();
 
     return true;
@@ -354,9 +410,16 @@ bool WrdUiModel::moveRows(const QModelIndex & /*sourceParent*/, int sourceRow, i
             break;
 
         case 2:
+        {
             (*wrd_file).strings.move(sourceRow + r, destinationRow + r);
+
+            QVector<uint> *ids = externalStringIds();
+            if (ids != nullptr && sourceRow + r < ids->count() && destinationRow + r < ids->count())
+                ids->move(sourceRow + r, destinationRow + r);
             break;
         }
+        }
+        row_cache.move(sourceRow + r, destinationRow + r);
     }
     endMoveRows();
 
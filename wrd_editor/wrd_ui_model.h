@@ -19,10 +19,25 @@ public:
     bool removeRows(int row, int count, const QModelIndex &parent = QModelIndex()) override;
     bool moveRows(const QModelIndex &sourceParent, int sourceRow, int count, const QModelIndex &destinationParent, int destinationChild) override;
     Qt::ItemFlags flags(const QModelIndex &index) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+public slots:
+    // Drops every formatted row, e.g. when the params/strings referenced by the code change.
+    void clearCache();
 
 private:
+    int totalRowCount() const;
+    QStringList formatRow(const int row) const;
+    // The STX string IDs to keep in step with the strings, if they're stored externally.
+    QVector<uint> *externalStringIds();
+
     WrdFile *wrd_file;
     int data_mode;  // 0 = code, 1 = params, 2 = strings
+    int loaded_rows;
+    // Display strings for each loaded row, formatted the first time the row is shown.
+    // Code rows hold {opcode, args, parsed args}, params/strings rows hold just their text.
+    mutable QVector<QStringList> row_cache;
 
 signals:
     void editCompleted(const QString &str);
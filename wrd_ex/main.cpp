@@ -0,0 +1,519 @@
+#include <QDir>
+#include <QHash>
+#include "../utils/batch.h"
+#include "../utils/binarydata.h"
+#include "../utils/wrd.h"
+#include "../utils/wrdcorpus.h"
+
+// Disassembled scripts use this extension, so they can live alongside
+// the .txt files produced by stx_ex without being mistaken for them.
+const QString ASM_EXT = ".wrdasm";
+
+void unpack(const QString in_path);
+QString unpack_file(const QString in_filepath, const QString out_filepath);
+void repack(const QString in_path);
+QString repack_file(const QString in_filepath, const QString out_filepath);
+QString disassemble(const QByteArray &bytes, const QString filename);
+bool assemble(const QString &text, WrdFile &wrd, QString &error);
+QString quote_str(QString str);
+bool tokenize(const QString &line, QStringList &tokens);
+void find(const QString in_path, const QString param);
+
+int main(int argc, char *argv[])
+{
+    QString in_path;
+    bool pack = false;
+    QString param;
+
+    // Parse args
+    for (int i = 1; i < argc; i++)
+    {
+        QString arg = QString(argv[i]);
+
+        if (arg == "-p" || arg == "--pack")
+            pack = true;
+        else if ((arg == "-f" || arg == "--find") && i + 1 < argc)
+            param = QString(argv[++i]);
+        else if (in_path.isEmpty())
+            in_path = QDir(argv[i]).absolutePath();
+    }
+
+    if (in_path.isEmpty())
+    {
+        cout << "Error: No input path specified.\n";
+        cout.flush();
+        return 1;
+    }
+
+    if (!param.isEmpty())
+        find(in_path, param);
+    else if (pack)
+        repack(in_path);
+    else
+        unpack(in_path);
+
+    return 0;
+}
+
+// List every command in the WRD files under "in_path" which uses the param "param".
+void find(const QString in_path, const QString param)
+{
+    const WrdCorpus corpus = wrd_corpus_load(in_path);
+    for (const QString &error : corpus.errors)
+        cout << "Error: Failed to load " << error << "\n";
+
+    const QVector<WrdParamUse> uses = wrd_corpus_find_param(corpus, param);
+    for (const WrdParamUse &use : uses)
+    {
+        const WrdCorpusFile &file = corpus.files.at(use.file);
+        const WrdCmd &cmd = file.code.at(use.cmd);
+        cout << file.filename << " command " << use.cmd << ": " << (cmd.name.isEmpty() ? num_to_hex(cmd.opcode, 2) : cmd.name) << ", argument " << use.arg << "\n";
+    }
+
+    cout << uses.count() << " uses in " << corpus.files.count() << " files (" << corpus.names->count() << " unique label/param names).\n";
+    cout.flush();
+}
+
+void unpack(const QString in_path)
+{
+    if (QFileInfo(in_path).isDir())
+    {
+        QStringList wrdNames, outNames;
+        find_files(in_path, "*.wrd", in_path + "-ex", ASM_EXT, wrdNames, outNames);
+        process_files(wrdNames, outNames, unpack_file, in_path, "Disassembling");
+    }
+    else
+    {
+        if (QFileInfo(in_path).suffix().compare("wrd", Qt::CaseInsensitive) != 0)
+        {
+            cout << "This is not a .wrd file.\n";
+            cout.flush();
+            return;
+        }
+
+        QString outName = in_path;
+        outName.replace(outName.lastIndexOf(".wrd", -1, Qt::CaseInsensitive), 4, ASM_EXT);
+
+        const QString error = unpack_file(in_path, outName);
+        if (!error.isEmpty())
+        {
+            cout << "Error: " << error << "\n";
+            cout.flush();
+        }
+    }
+}
+
+QString unpack_file(const QString in_filepath, const QString out_filepath)
+{
+    QFile in(in_filepath);
+    if (!in.open(QFile::ReadOnly))
+        return "Failed to open file.";
+    const QByteArray bytes = in.readAll();
+    in.close();
+
+    const QString text = disassemble(bytes, in_filepath);
+
+    QDir().mkpath(QFileInfo(out_filepath).absolutePath());
+    QFile out(out_filepath);
+    if (!out.open(QFile::WriteOnly))
+        return "Failed to create \"" + out_filepath + "\".";
+    out.write(text.toUtf8());
+    out.close();
+
+    return QString();
+}
+
+void repack(const QString in_path)
+{
+    if (QFileInfo(in_path).isDir())
+    {
+        QStringList asmNames, outNames;
+        find_files(in_path, "*" + ASM_EXT, in_path + "-cmp", ".wrd", asmNames, outNames);
+        process_files(asmNames, outNames, repack_file, in_path, "Assembling");
+    }
+    else
+    {
+        if (!in_path.endsWith(ASM_EXT, Qt::CaseInsensitive))
+        {
+            cout << "This is not a " << ASM_EXT << " file.\n";
+            cout.flush();
+            return;
+        }
+
+        // Like batch mode's "-cmp" directory, so the original .wrd isn't overwritten
+        QString outName = in_path;
+        outName.chop(ASM_EXT.size());
+
+        const QString error = repack_file(in_path, outName + "-cmp.wrd");
+        if (!error.isEmpty())
+        {
+            cout << "Error: " << error << "\n";
+            cout.flush();
+        }
+    }
+}
+
+QString repack_file(const QString in_filepath, const QString out_filepath)
+{
+    QFile in(in_filepath);
+    if (!in.open(QFile::ReadOnly))
+        return "Failed to open file.";
+    const QString text = QString::fromUtf8(in.readAll());
+    in.close();
+
+    WrdFile wrd;
+    QString error;
+    if (!assemble(text, wrd, error))
+        return error;
+
+    QDir().mkpath(QFileInfo(out_filepath).absolutePath());
+    QFile out(out_filepath);
+    if (!out.open(QFile::WriteOnly))
+        return "Failed to create \"" + out_filepath + "\".";
+    out.write(wrd_to_bytes(wrd));
+    out.close();
+
+    return QString();
+}
+
+
+
+// The disassembly is split into sections, each started by a directive:
+//
+//   .external_strings N    Strings live in an external STX file, and there are N of them
+//   .labels / .params / .strings
+//                          One quoted entry per line, in index order
+//   .code                  One command per line: NAME arg arg ...
+//
+// A quoted command argument refers to an entry in the table matching its
+// argument type (param, string or label), while a bare number is written as-is.
+// Anything after a ';' outside of quotes is a comment.
+QString disassemble(const QByteArray &bytes, const QString filename)
+{
+    const WrdFile wrd = wrd_from_bytes(bytes, filename);
+
+    // The string count in the header is still meaningful when the strings are external,
+    // but wrd_from_bytes only knows about the strings it could actually find.
+    int pos = 0;
+    const ushort str_count = num_from_bytes<ushort>(bytes, pos);
+
+    // Table entries can only be referenced by name if that name
+    // maps back to the same index when we re-assemble.
+    QHash<QString, int> param_indexes;
+    for (int i = wrd.params.count() - 1; i >= 0; i--)
+        param_indexes[wrd.params.at(i)] = i;
+    QHash<QString, int> label_indexes;
+    for (int i = wrd.labels.count() - 1; i >= 0; i--)
+        label_indexes[wrd.labels.at(i)] = i;
+
+    QString result;
+    QTextStream out(&result);
+    out << "; Disassembled from " << QFileInfo(filename).fileName() << "\n";
+
+    if (wrd.external_strings)
+        out << ".external_strings " << str_count << "\n";
+
+    out << "\n.labels\n";
+    for (const QString &label : wrd.labels)
+        out << quote_str(label) << "\n";
+
+    out << "\n.params\n";
+    for (const QString &param : wrd.params)
+        out << quote_str(param) << "\n";
+
+    if (!wrd.external_strings)
+    {
+        out << "\n.strings\n";
+        for (const QString &str : wrd.strings)
+            out << quote_str(str) << "\n";
+    }
+
+    out << "\n.code\n";
+    for (const WrdCmd &cmd : wrd.code)
+    {
+        if (cmd.name == "UNKNOWN_CMD")
+            out << "OP_" << num_to_hex(cmd.opcode, 2);
+        else
+            out << cmd.name;
+
+        QString comment;
+        for (int a = 0; a < cmd.args.count(); a++)
+        {
+            const ushort arg = cmd.args.at(a);
+            const uchar arg_type = (a < cmd.arg_types.count()) ? cmd.arg_types.at(a) : 1;
+
+            if (arg_type == 0 && arg < wrd.params.count() && param_indexes.value(wrd.params.at(arg)) == arg)
+            {
+                out << " " << quote_str(wrd.params.at(arg));
+            }
+            else if (arg_type == 3 && arg < wrd.labels.count() && label_indexes.value(wrd.labels.at(arg)) == arg)
+            {
+                out << " " << quote_str(wrd.labels.at(arg));
+            }
+            else
+            {
+                out << " " << arg;
+
+                // Strings are referenced by index, since they're usually long
+                // (and often external), but show the text to make it readable.
+                if (arg_type == 2 && arg < wrd.strings.count())
+                    comment += " " + quote_str(wrd.strings.at(arg));
+            }
+        }
+
+        if (!comment.isEmpty())
+            out << "    ;" << comment;
+        out << "\n";
+    }
+
+    out.flush();
+    return result;
+}
+
+QHash<QString, int> get_known_cmd_indexes()
+{
+    QHash<QString, int> result;
+    for (uint i = 0; i < sizeof(KNOWN_CMDS) / sizeof(WrdCmd); i++)
+        result[KNOWN_CMDS[i].name] = i;
+    return result;
+}
+
+bool assemble(const QString &text, WrdFile &wrd, QString &error)
+{
+    static const QHash<QString, int> known_cmd_indexes = get_known_cmd_indexes();
+
+    wrd.external_strings = false;
+
+    QString section;
+    QHash<QString, int> param_indexes;
+    QHash<QString, int> label_indexes;
+    QHash<QString, int> string_indexes;
+    int external_str_count = 0;
+
+    const QStringList lines = text.split('\n');
+    for (int l = 0; l < lines.count(); l++)
+    {
+        const QString line_num = "Line " + QString::number(l + 1) + ": ";
+
+        QStringList tokens;
+        if (!tokenize(lines.at(l), tokens))
+        {
+            error = line_num + "Unterminated quoted string.";
+            return false;
+        }
+        if (tokens.isEmpty())
+            continue;
+
+        const QString first = tokens.at(0);
+
+        if (first.startsWith('.'))
+        {
+            section = first;
+
+            if (section == ".external_strings")
+            {
+                wrd.external_strings = true;
+                if (tokens.count() > 1)
+                    external_str_count = tokens.at(1).toInt();
+            }
+            else if (section != ".labels" && section != ".params" && section != ".strings" && section != ".code")
+            {
+                error = line_num + "Unknown directive \"" + section + "\".";
+                return false;
+            }
+            continue;
+        }
+
+        if (section == ".labels" || section == ".params" || section == ".strings")
+        {
+            if (tokens.count() != 1 || !first.startsWith('"'))
+            {
+                error = line_num + "Expected a single quoted string.";
+                return false;
+            }
+
+            const QString value = first.mid(1);
+            if (section == ".labels")
+            {
+                if (!label_indexes.contains(value))
+                    label_indexes[value] = wrd.labels.count();
+                wrd.labels.append(value);
+            }
+            else if (section == ".params")
+            {
+                if (!param_indexes.contains(value))
+                    param_indexes[value] = wrd.params.count();
+                wrd.params.append(value);
+            }
+            else
+            {
+                if (!string_indexes.contains(value))
+                    string_indexes[value] = wrd.strings.count();
+                wrd.strings.append(value);
+            }
+        }
+        else if (section == ".code")
+        {
+            WrdCmd cmd;
+            cmd.name = "UNKNOWN_CMD";
+
+            if (known_cmd_indexes.contains(first))
+            {
+                const WrdCmd &known_cmd = KNOWN_CMDS[known_cmd_indexes.value(first)];
+                cmd.opcode = known_cmd.opcode;
+                cmd.name = known_cmd.name;
+                cmd.arg_types = known_cmd.arg_types;
+            }
+            else
+            {
+                bool ok = first.startsWith("OP_") && first.size() == 5;
+                if (ok)
+                    cmd.opcode = (uchar)first.mid(3).toUInt(&ok, 16);
+
+                if (!ok)
+                {
+                    error = line_num + "Unknown command \"" + first + "\".";
+                    return false;
+                }
+            }
+
+            for (int a = 1; a < tokens.count(); a++)
+            {
+                const QString token = tokens.at(a);
+                const uchar arg_type = (a - 1 < cmd.arg_types.count()) ? cmd.arg_types.at(a - 1) : 1;
+
+                if (token.startsWith('"'))
+                {
+                    const QString value = token.mid(1);
+                    const QHash<QString, int> *table = nullptr;
+                    if (arg_type == 0)
+                        table = &param_indexes;
+                    else if (arg_type == 2)
+                        table = &string_indexes;
+                    else if (arg_type == 3)
+                        table = &label_indexes;
+
+                    if (table == nullptr || !table->contains(value))
+                    {
+                        error = line_num + "Unknown reference " + quote_str(value) + ".";
+                        return false;
+                    }
+
+                    cmd.args.append(table->value(value));
+                }
+                else
+                {
+                    bool ok;
+                    const ushort arg = token.toUShort(&ok, 0);
+                    if (!ok)
+                    {
+                        error = line_num + "Invalid argument \"" + token + "\".";
+                        return false;
+                    }
+
+                    cmd.args.append(arg);
+                }
+            }
+
+            for (int i = cmd.arg_types.count(); i < cmd.args.count(); i++)
+                cmd.arg_types.append(0);
+
+            wrd.code.append(cmd);
+        }
+        else
+        {
+            error = line_num + "Data found outside of any section.";
+            return false;
+        }
+    }
+
+    // The strings themselves aren't stored in the WRD file in this case,
+    // but the header still needs to know how many there are.
+    if (wrd.external_strings)
+    {
+        wrd.strings.clear();
+        for (int i = 0; i < external_str_count; i++)
+            wrd.strings.append(QString());
+    }
+
+    return true;
+}
+
+QString quote_str(QString str)
+{
+    str.replace("\\", "\\\\");
+    str.replace("\"", "\\\"");
+    str.replace("\n", "\\n");
+    str.replace("\r", "\\r");
+    str.replace("\t", "\\t");
+    return '"' + str + '"';
+}
+
+// Split a line into whitespace-separated tokens, stopping at a ';' comment.
+// Quoted strings are un-escaped and returned with only their leading quote,
+// so they can still be told apart from bare numbers and command names.
+// Returns false if a quoted string isn't closed before the end of the line.
+bool tokenize(const QString &line, QStringList &tokens)
+{
+    tokens.clear();
+    QString token;
+    bool in_token = false;
+    bool in_quotes = false;
+
+    for (int i = 0; i < line.size(); i++)
+    {
+        const QChar c = line.at(i);
+
+        if (in_quotes)
+        {
+            if (c == '"')
+            {
+                in_quotes = false;
+            }
+            else if (c == '\\' && i + 1 < line.size())
+            {
+                const QChar e = line.at(++i);
+                if (e == 'n')
+                    token += '\n';
+                else if (e == 'r')
+                    token += '\r';
+                else if (e == 't')
+                    token += '\t';
+                else
+                    token += e;
+            }
+            else
+            {
+                token += c;
+            }
+            continue;
+        }
+
+        if (c == ';')
+            break;
+
+        if (c.isSpace())
+        {
+            if (in_token)
+            {
+                tokens.append(token);
+                token.clear();
+                in_token = false;
+            }
+            continue;
+        }
+
+        in_token = true;
+        if (c == '"')
+            in_quotes = true;
+        token += c;
+    }
+
+    if (in_quotes)
+        return false;
+
+    if (in_token)
+        tokens.append(token);
+
+    return true;
+}